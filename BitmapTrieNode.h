@@ -0,0 +1,370 @@
+// This source was written by Stephen Oswin, and is placed in the
+// public domain. The author hereby disclaims copyright to this source
+// code.
+
+#ifndef __BITMAPTRIENODE_H
+#define __BITMAPTRIENODE_H
+
+#include <cstring>
+#include <new>
+
+#include "Trie.h"
+
+namespace TDS
+{
+
+// number of bits set in v
+inline unsigned int PopCount( unsigned long long v )
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll(v);
+#else
+	unsigned int count = 0;
+	for (; v; v &= v - 1)
+	{
+		++count;
+	}
+	return count;
+#endif
+}
+
+// Trie node for Trie<char>. Rather than a sorted array of children it has
+// a 256 bit bitmap with a bit set for each character that has a child, and
+// the children packed in character order after it. The index of a child is
+// the number of bits set below its character, so FindNode() is a bit test
+// and a popcount instead of a binary search. Only the 64 bit words of the
+// bitmap that have a bit set are stored, and a 4 bit mask in the node says
+// which, so children that are all lower case letters need one word. The
+// words and children share one allocation, and nodes without children
+// have none. The child list grows by doubling, so it always has room for
+// the child count rounded up to a power of two and needs no capacity
+// field. A node is 16 bytes plus 8 per bitmap word and 8 per child (so
+// rounded) when it has children, and after Trie::Relayout() exactly 8 per
+// word and child.
+// Use it as Trie<char,BitmapTrieNode>.
+class BitmapTrieNode
+{
+	public:
+		BitmapTrieNode (char c) : _children(NULL), _c(c), _endOfWord(false), _packed(false), _words(0), _wordId(0) {}
+		~BitmapTrieNode()
+		{
+			for( size_t i =  0; i < GetChildCount(); ++i)
+			{
+				delete Nodes()[i];
+			}
+			FreeChildren();
+		}
+
+		// Gets the character for the node
+		char GetChar() const { return _c; }
+
+		// the capacity of a child list is implied by its count so there is
+		// nothing to trim. Recurses for consistency with TrieNode.
+		void Compress()
+		{
+			for( size_t i =  0; i < GetChildCount(); ++i)
+			{
+				Nodes()[i]->Compress();
+			}
+		}
+
+		// deep copy of this node and everything below it
+		BitmapTrieNode* Clone() const
+		{
+			BitmapTrieNode* newNode = new BitmapTrieNode(_c);
+			newNode->_endOfWord = _endOfWord;
+			newNode->_wordId = _wordId;
+			if (_children)
+			{
+				const size_t count = GetChildCount();
+				newNode->_children = AllocateChildren(_words, RoundUpToPowerOfTwo(count));
+				newNode->_words = _words;
+				std::copy(_children, _children + WordCount(), newNode->_children);
+				for( size_t i =  0; i < count; ++i)
+				{
+					newNode->Nodes()[i] = Nodes()[i]->Clone();
+				}
+			}
+			return newNode;
+		}
+
+		// bytes needed to hold the bitmap and children with no spare room,
+		// see CopyTo()
+		size_t GetPackedSize() const
+		{
+			return _children ? ChildrenSize(_words, GetChildCount()) : 0;
+		}
+		// shallow copy of this node into place with its bitmap and children
+		// at children, which the copy does not own, holding newChildren in
+		// place of this node's children. See TrieNode::CopyTo().
+		BitmapTrieNode* CopyTo( void* place, void* children, BitmapTrieNode* const* newChildren ) const
+		{
+			BitmapTrieNode* newNode = new (place) BitmapTrieNode(_c);
+			newNode->_endOfWord = _endOfWord;
+			newNode->_wordId = _wordId;
+			if (_children)
+			{
+				newNode->_children = static_cast<unsigned long long*>(children);
+				newNode->_packed = true;
+				newNode->_words = _words;
+				std::copy(_children, _children + WordCount(), newNode->_children);
+				std::copy(newChildren, newChildren + GetChildCount(), newNode->Nodes());
+			}
+			return newNode;
+		}
+
+		// invariant
+		bool ValidateState() const
+		{
+			if (_children)
+			{
+				// if we have children there must be at least one, no
+				// bitmap word is stored empty, and each child must be filed
+				// under its own character
+				if (0==_words)
+				{
+					return false;
+				}
+				for( unsigned int i =  0; i < WordCount(); ++i)
+				{
+					if (0==_children[i])
+					{
+						return false;
+					}
+				}
+				for( size_t i =  0; i < GetChildCount(); ++i)
+				{
+					const BitmapTrieNode* child = Nodes()[i];
+					if (child != FindNode(child->GetChar()) || false==child->ValidateState())
+					{
+						return false;
+					}
+				}
+			}
+			else if (!this->IsEndOfWord() || _words)
+			{
+				return false;
+			}
+			return true;
+		}
+
+		// AddNode adds a new node. Returns NULL if there already is a child
+		// for c.
+		BitmapTrieNode* AddNode (char c)
+		{
+			if (FindNode(c))
+			{
+				return NULL;
+			}
+			BitmapTrieNode* newNode = new BitmapTrieNode(c);
+			AttachNode(newNode);
+			return newNode;
+		}
+
+		// AttachNode adds an existing node as a child. The node must not
+		// duplicate an existing child.
+		void AttachNode( BitmapTrieNode* node, size_t = 0 )
+		{
+			const unsigned char u = static_cast<unsigned char>(node->GetChar());
+			const unsigned int word = 1u << (u >> 6);
+			const size_t count = GetChildCount();
+			// a count that is a power of two fills the list
+			const bool full = NULL==_children || _packed || 0 == (count & (count - 1));
+			if (full || 0 == (_words & word))
+			{
+				Resize(_words | word, RoundUpToPowerOfTwo(full ? count + 1 : count));
+			}
+			const size_t index = ChildIndex(u);
+			BitmapTrieNode** nodes = Nodes();
+			std::copy_backward(nodes + index, nodes + count, nodes + count + 1);
+			_children[WordIndex(u)] |= 1ULL << (u & 63);
+			nodes[index] = node;
+		}
+
+		// Destroys the children of a node graph that was relaid out into a
+		// single allocation. See TrieNode::DestroyArena().
+		void DestroyArena( const BitmapTrieNode* arenaBegin, const BitmapTrieNode* arenaEnd )
+		{
+			std::less<const BitmapTrieNode*> lessThan;
+			for( size_t i =  0; i < GetChildCount(); ++i)
+			{
+				BitmapTrieNode* child = Nodes()[i];
+				if (!lessThan(child, arenaBegin) && lessThan(child, arenaEnd))
+				{
+					child->DestroyArena(arenaBegin, arenaEnd);
+					child->~BitmapTrieNode();
+				}
+				else
+				{
+					delete child;
+				}
+			}
+			FreeChildren();
+		}
+
+		// forgets the children without deleting them, once they have been
+		// attached to another node
+		void DetachChildren()
+		{
+			FreeChildren();
+		}
+
+		// number of child nodes
+		size_t GetChildCount() const
+		{
+			size_t count = 0;
+			for( unsigned int i =  0; i < WordCount(); ++i)
+			{
+				count += PopCount(_children[i]);
+			}
+			return count;
+		}
+		// child node at index i. Children are in unsigned character order.
+		const BitmapTrieNode* GetChild( size_t i ) const { return Nodes()[i]; }
+		// indicates this is an end node (ie no child nodes)
+		bool IsEndNode() const  { return NULL==_children; }
+		// indicates this node terminates a word
+		bool IsEndOfWord() const  { return _endOfWord; }
+		// setter for end of word flag
+		void SetEndOfWord() { _endOfWord = true; }
+		// id of the word ending at this node. Only valid if IsEndOfWord().
+		unsigned int GetWordId() const { return _wordId; }
+		void SetWordId( unsigned int wordId ) { _wordId = wordId; }
+
+		// starts loading the bitmap and child list ahead of a FindNode()
+		void PrefetchChildren() const
+		{
+			TRIE_PREFETCH(_children);
+		}
+		// FindNode searches child nodes for
+		// a particular BitmapTrieNode
+		BitmapTrieNode* FindNode( char c ) const
+		{
+			const unsigned char u = static_cast<unsigned char>(c);
+			if (_words & (1u << (u >> 6)))
+			{
+				const unsigned int w = WordIndex(u);
+				const unsigned long long bit = 1ULL << (u & 63);
+				if (_children[w] & bit)
+				{
+					size_t index = PopCount(_children[w] & (bit - 1));
+					for (unsigned int i = 0; i < w; ++i)
+					{
+						index += PopCount(_children[i]);
+					}
+					return Nodes()[index];
+				}
+			}
+			return NULL;
+		}
+#ifdef TRIE_STATS
+		// no comparisons are made, provided for TRIE_STATS builds
+		BitmapTrieNode* FindNode( char c, size_t& ) const
+		{
+			return FindNode(c);
+		}
+#endif
+
+	private:
+		BitmapTrieNode& operator=(const BitmapTrieNode& rhs);
+		BitmapTrieNode(const BitmapTrieNode& rhs);
+
+		// _children holds the bitmap words listed in words followed by the
+		// child pointers, one per bit set
+		static size_t ChildrenSize( unsigned int words, size_t capacity )
+		{
+			return PopCount(words) * sizeof(unsigned long long) + capacity * sizeof(BitmapTrieNode*);
+		}
+		static unsigned long long* AllocateChildren( unsigned int words, size_t capacity )
+		{
+			return static_cast<unsigned long long*>(::operator new(ChildrenSize(words, capacity)));
+		}
+		// smallest power of two that is at least n
+		static size_t RoundUpToPowerOfTwo( size_t n )
+		{
+			size_t capacity = 1;
+			while (capacity < n)
+			{
+				capacity *= 2;
+			}
+			return capacity;
+		}
+
+		// number of bitmap words stored
+		unsigned int WordCount() const { return PopCount(_words); }
+		// where the bitmap word for u is stored, if it is
+		unsigned int WordIndex( unsigned char u ) const
+		{
+			return PopCount(_words & ((1u << (u >> 6)) - 1));
+		}
+		BitmapTrieNode** Nodes() const
+		{
+			return reinterpret_cast<BitmapTrieNode**>(_children + WordCount());
+		}
+
+		// moves the children to a list with the bitmap words in words and
+		// room for capacity children
+		void Resize( unsigned int words, size_t capacity )
+		{
+			unsigned long long* children = AllocateChildren(words, capacity);
+			BitmapTrieNode** nodes = reinterpret_cast<BitmapTrieNode**>(children + PopCount(words));
+			unsigned int from = 0;
+			for (unsigned int w = 0, to = 0; w < 4; ++w)
+			{
+				if (words & (1u << w))
+				{
+					children[to++] = (_words & (1u << w)) ? _children[from++] : 0;
+				}
+			}
+			if (_children)
+			{
+				std::copy(Nodes(), Nodes() + GetChildCount(), nodes);
+				FreeChildren();
+			}
+			_children = children;
+			_words = static_cast<unsigned char>(words);
+		}
+		// frees the child list unless Trie::Relayout() packed it into its
+		// arena
+		void FreeChildren()
+		{
+			if (!_packed)
+			{
+				::operator delete(_children);
+			}
+			_children = NULL;
+			_packed = false;
+			_words = 0;
+		}
+
+		// index of the child for u, or where it would be inserted: the
+		// number of children with a lower character
+		size_t ChildIndex( unsigned char u ) const
+		{
+			const unsigned int w = WordIndex(u);
+			size_t index = 0;
+			for (unsigned int i = 0; i < w; ++i)
+			{
+				index += PopCount(_children[i]);
+			}
+			if (_words & (1u << (u >> 6)))
+			{
+				index += PopCount(_children[w] & ((1ULL << (u & 63)) - 1));
+			}
+			return index;
+		}
+
+	protected:
+		unsigned long long* _children;
+		char _c;
+		bool _endOfWord;
+		// the child list is in a Trie::Relayout() arena, it is not freed
+		// and only has room for the children it holds
+		bool _packed;
+		// bit w set when bitmap word w (characters 64w to 64w+63) is stored
+		unsigned char _words;
+		unsigned int _wordId;
+};
+
+}
+#endif
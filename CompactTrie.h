@@ -0,0 +1,206 @@
+// This source was written by Stephen Oswin, and is placed in the
+// public domain. The author hereby disclaims copyright to this source
+// code.
+
+#ifndef __COMPACTTRIE_H
+#define __COMPACTTRIE_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Trie.h"
+
+namespace TDS
+{
+
+// Read only copy of a Trie in as little memory as possible, for very large
+// dictionaries that are built once and then only searched. There are no
+// pointers. The nodes are numbered breadth first, so the children of a
+// node are consecutive and every node but the root is reached by exactly
+// one edge: edge e leads to node e + 1 and needs no target stored. Each
+// node is then one 32 bit word holding the index of its first edge, with
+// the end of word flag in the top bit, plus its word id. The edge labels
+// are in one array with the labels of each node's children together and
+// sorted, so FindNode() scans or binary searches a short contiguous run.
+// That is 8 bytes plus one character per node, against 16 bytes for a
+// TrieNode before its child list is counted.
+//
+// Search(), Contains() and LongestPrefix() work as they do on a Trie. The
+// handles in results are not the ones the Trie's AddWord() returned; use
+// GetWordId() to get the word id, which is the same in both. Tags are not
+// kept. Up to 2^31 nodes, the constructor throws std::length_error for a
+// bigger trie.
+template<typename CharType>
+class CompactTrie
+{
+	public:
+		CompactTrie() : _nodes(2, 0), _wordIds(1, 0), _wordCount(0)
+		{
+		}
+
+		// copies t, which can use any node type
+		template<typename NodeType>
+		explicit CompactTrie( const Trie<CharType,NodeType>& t ) : _wordCount(t.GetWordCount())
+		{
+			std::vector<const NodeType*> queue;
+			std::vector<std::pair<CharType,const NodeType*> > children;
+			queue.push_back(t.GetRootNode());
+
+			// queue[i] becomes node i. Its children are queued together, in
+			// the order FindNode() searches them, and the labels follow
+			// the queue so edge e is the edge to node e + 1.
+			for (size_t i = 0; i < queue.size(); ++i)
+			{
+				const NodeType* pTN = queue[i];
+				_nodes.push_back(static_cast<unsigned int>(queue.size() - 1) |
+								 (pTN->IsEndOfWord() ? EndOfWordBit : 0));
+				_wordIds.push_back(pTN->IsEndOfWord() ? pTN->GetWordId() : 0);
+
+				children.clear();
+				for (size_t c = 0; c < pTN->GetChildCount(); ++c)
+				{
+					children.push_back(std::make_pair(pTN->GetChild(c)->GetChar(), pTN->GetChild(c)));
+				}
+				std::sort(children.begin(), children.end());
+				for (size_t c = 0; c < children.size(); ++c)
+				{
+					_labels.push_back(children[c].first);
+					queue.push_back(children[c].second);
+				}
+				// node and edge indices must leave the top bit free
+				if (queue.size() > EndOfWordBit)
+				{
+					throw std::length_error("CompactTrie: too many nodes");
+				}
+			}
+			// the end of the last node's edges
+			_nodes.push_back(static_cast<unsigned int>(_labels.size()));
+			_nodes.shrink_to_fit();
+			_wordIds.shrink_to_fit();
+			_labels.shrink_to_fit();
+		}
+
+		// See Trie::Search()
+		void Search(const CharType* buffStart,
+					const CharType* buffEnd,
+					std::vector<SearchResult<CharType> >& searchResults,
+					bool stopAtFirstMatch = false) const
+		{
+			unsigned int node = 0;
+			for (const CharType* buff = buffStart; buff <= buffEnd; ++buff)
+			{
+				node = FindNode(node, *buff);
+				if (0 == node)
+				{
+					return;
+				}
+				else if (_nodes[node] & EndOfWordBit)
+				{
+					SearchResult<CharType> st(&_wordIds[node],buff);
+					searchResults.push_back(st);
+
+					if (stopAtFirstMatch)
+					{
+						return;
+					}
+				}
+			}
+		}
+
+		// See Trie::Contains()
+		const void* Contains( const CharType* p, const CharType* end ) const
+		{
+			unsigned int node = 0;
+			for (; p <= end; ++p)
+			{
+				node = FindNode(node, *p);
+				if (0 == node)
+				{
+					return NULL;
+				}
+			}
+			return (node && (_nodes[node] & EndOfWordBit)) ? &_wordIds[node] : NULL;
+		}
+
+		// See Trie::LongestPrefix()
+		const void* LongestPrefix( const CharType* p, const CharType* end, const CharType** position = NULL ) const
+		{
+			unsigned int node = 0;
+			const void* longest = NULL;
+			const CharType* longestEnd = NULL;
+			for (; p <= end; ++p)
+			{
+				node = FindNode(node, *p);
+				if (0 == node)
+				{
+					break;
+				}
+				if (_nodes[node] & EndOfWordBit)
+				{
+					longest = &_wordIds[node];
+					longestEnd = p;
+				}
+			}
+			if (position)
+			{
+				*position = longestEnd;
+			}
+			return longest;
+		}
+
+		// Child of node for c, or 0 (the root, which is nobody's child) if
+		// there is none.
+		unsigned int FindNode( unsigned int node, CharType c ) const
+		{
+			const unsigned int first = _nodes[node] & ~EndOfWordBit;
+			const unsigned int last = _nodes[node + 1] & ~EndOfWordBit;
+			const CharType* labels = _labels.data();
+			unsigned int edge = first;
+			if (last - first <= ScanLimit)
+			{
+				for (; edge < last && labels[edge] < c; ++edge)
+				{
+				}
+			}
+			else
+			{
+				edge = static_cast<unsigned int>(std::lower_bound(labels + first, labels + last, c) - labels);
+			}
+			return (edge < last && labels[edge] == c) ? edge + 1 : 0;
+		}
+
+		// converts a handle in a SearchResult, or returned by Contains() or
+		// LongestPrefix(), into the id of the word
+		static unsigned int GetWordId( const void* handle )
+		{
+			return *static_cast<const unsigned int*>(handle);
+		}
+
+		size_t GetWordCount() const { return _wordCount; }
+		size_t GetNodeCount() const { return _wordIds.size(); }
+		// bytes used by the tables
+		size_t GetMemoryUsage() const
+		{
+			return _nodes.capacity() * sizeof(unsigned int) + _wordIds.capacity() * sizeof(unsigned int) +
+				   _labels.capacity() * sizeof(CharType);
+		}
+
+	private:
+		static const unsigned int EndOfWordBit = 1u << 31;
+		// up to this many children are scanned rather than binary searched
+		static const unsigned int ScanLimit = 16;
+
+		// per node the index of its first edge and the end of word flag,
+		// with one extra entry marking the end of the last node's edges
+		std::vector<unsigned int> _nodes;
+		// per node the word id, only meaningful for the ends of words
+		std::vector<unsigned int> _wordIds;
+		// per edge the character, edge e leads to node e + 1
+		std::vector<CharType> _labels;
+		size_t _wordCount;
+};
+
+}
+#endif
@@ -0,0 +1,315 @@
+// This source was written by Stephen Oswin, and is placed in the
+// public domain. The author hereby disclaims copyright to this source
+// code.
+
+#ifndef __DENSETRIENODE_H
+#define __DENSETRIENODE_H
+
+#include <new>
+#include <type_traits>
+
+#include "Trie.h"
+
+namespace TDS
+{
+
+// Trie node with a direct lookup table of children. The table covers the
+// range of characters from the lowest child to the highest, with a slot
+// for every character in between, so FindNode() is a subtraction, a range
+// check and a load with no searching at all. The price is memory for the
+// empty slots, so it suits small dense alphabets such as lower case words
+// or digits. A node is 16 bytes, plus 16 + 8 per slot when it has
+// children. Children are in unsigned character order.
+// Only for single byte characters, so a table never has more than 256
+// slots. Use it as Trie<char,DenseTrieNode<char> >.
+template<typename CharType>
+class DenseTrieNode
+{
+		static_assert(sizeof(CharType) == 1, "DenseTrieNode is only for single byte characters");
+
+	public:
+		DenseTrieNode (CharType c) : _children(NULL), _c(c), _endOfWord(false), _wordId(0) {}
+		~DenseTrieNode()
+		{
+			for( size_t i =  0; _children && i < _children->_size; ++i)
+			{
+				delete _children->_slots[i];
+			}
+			FreeChildren(_children);
+		}
+
+		// Gets the character for the node
+		CharType GetChar() const { return _c; }
+
+		// the table always spans exactly the children so there is nothing
+		// to shrink. Recurses for consistency with TrieNode.
+		void Compress()
+		{
+			for( size_t i =  0; _children && i < _children->_size; ++i)
+			{
+				if (_children->_slots[i])
+				{
+					_children->_slots[i]->Compress();
+				}
+			}
+		}
+
+		// deep copy of this node and everything below it
+		DenseTrieNode* Clone() const
+		{
+			DenseTrieNode* newNode = new DenseTrieNode(_c);
+			newNode->_endOfWord = _endOfWord;
+			newNode->_wordId = _wordId;
+			if (_children)
+			{
+				newNode->_children = AllocateChildren(_children->_low, _children->_size);
+				newNode->_children->_count = _children->_count;
+				for( size_t i =  0; i < _children->_size; ++i)
+				{
+					if (_children->_slots[i])
+					{
+						newNode->_children->_slots[i] = _children->_slots[i]->Clone();
+					}
+				}
+			}
+			return newNode;
+		}
+
+		// bytes needed to hold the table, see CopyTo()
+		size_t GetPackedSize() const
+		{
+			return _children ? ChildrenSize(_children->_size) : 0;
+		}
+		// shallow copy of this node into place with its table at children,
+		// which the copy does not own, holding newChildren in place of this
+		// node's children. See TrieNode::CopyTo().
+		DenseTrieNode* CopyTo( void* place, void* children, DenseTrieNode* const* newChildren ) const
+		{
+			DenseTrieNode* newNode = new (place) DenseTrieNode(_c);
+			newNode->_endOfWord = _endOfWord;
+			newNode->_wordId = _wordId;
+			if (_children)
+			{
+				newNode->_children = static_cast<Children*>(children);
+				newNode->_children->_low = _children->_low;
+				newNode->_children->_packed = true;
+				newNode->_children->_size = _children->_size;
+				newNode->_children->_count = _children->_count;
+				for( size_t i =  0; i < _children->_size; ++i)
+				{
+					newNode->_children->_slots[i] = _children->_slots[i] ? *newChildren++ : NULL;
+				}
+			}
+			return newNode;
+		}
+
+		// invariant
+		bool ValidateState() const
+		{
+			if (_children)
+			{
+				// each child must be in the slot for its character, the
+				// count must be right and the first and last slots used
+				size_t count = 0;
+				for( size_t i =  0; i < _children->_size; ++i)
+				{
+					const DenseTrieNode* child = _children->_slots[i];
+					if (child)
+					{
+						if (child != FindNode(child->GetChar()) || false==child->ValidateState())
+						{
+							return false;
+						}
+						++count;
+					}
+				}
+				if (0==count || count != _children->_count ||
+					NULL==_children->_slots[0] || NULL==_children->_slots[_children->_size - 1])
+				{
+					return false;
+				}
+			}
+			else if (!this->IsEndOfWord())
+			{
+				return false;
+			}
+			return true;
+		}
+
+		// AddNode adds a new node. Returns NULL if there already is a child
+		// for c.
+		DenseTrieNode* AddNode (CharType c)
+		{
+			if (FindNode(c))
+			{
+				return NULL;
+			}
+			DenseTrieNode* newNode = new DenseTrieNode(c);
+			AttachNode(newNode);
+			return newNode;
+		}
+
+		// AttachNode adds an existing node as a child, widening the table if
+		// its character is outside it. The node must not duplicate an
+		// existing child.
+		void AttachNode( DenseTrieNode* node, size_t = 0 )
+		{
+			const UnsignedChar u = static_cast<UnsignedChar>(node->GetChar());
+			if (NULL==_children)
+			{
+				_children = AllocateChildren(u, 1);
+			}
+			else
+			{
+				const UnsignedChar low = _children->_low;
+				const UnsignedChar high = static_cast<UnsignedChar>(low + _children->_size - 1);
+				if (u < low || u > high)
+				{
+					const UnsignedChar newLow = std::min(u, low);
+					Children* children = AllocateChildren(newLow, static_cast<size_t>(std::max(u, high) - newLow) + 1);
+					children->_count = _children->_count;
+					std::copy(_children->_slots, _children->_slots + _children->_size, children->_slots + (low - newLow));
+					FreeChildren(_children);
+					_children = children;
+				}
+			}
+			_children->_slots[u - _children->_low] = node;
+			++_children->_count;
+		}
+
+		// Destroys the children of a node graph that was relaid out into a
+		// single allocation. See TrieNode::DestroyArena().
+		void DestroyArena( const DenseTrieNode* arenaBegin, const DenseTrieNode* arenaEnd )
+		{
+			std::less<const DenseTrieNode*> lessThan;
+			for( size_t i =  0; _children && i < _children->_size; ++i)
+			{
+				DenseTrieNode* child = _children->_slots[i];
+				if (NULL==child)
+				{
+					continue;
+				}
+				if (!lessThan(child, arenaBegin) && lessThan(child, arenaEnd))
+				{
+					child->DestroyArena(arenaBegin, arenaEnd);
+					child->~DenseTrieNode();
+				}
+				else
+				{
+					delete child;
+				}
+			}
+			FreeChildren(_children);
+			_children = NULL;
+		}
+
+		// forgets the children without deleting them, once they have been
+		// attached to another node
+		void DetachChildren()
+		{
+			FreeChildren(_children);
+			_children = NULL;
+		}
+
+		// number of child nodes
+		size_t GetChildCount() const { return _children ? _children->_count : 0; }
+		// child node at index i, skipping the empty slots. Walking all the
+		// children this way is quadratic in the table size, which is fine
+		// for the small tables this node is meant for.
+		const DenseTrieNode* GetChild( size_t i ) const
+		{
+			for( size_t slot =  0; ; ++slot)
+			{
+				if (_children->_slots[slot] && 0 == i--)
+				{
+					return _children->_slots[slot];
+				}
+			}
+		}
+		// indicates this is an end node (ie no child nodes)
+		bool IsEndNode() const  { return NULL==_children; }
+		// indicates this node terminates a word
+		bool IsEndOfWord() const  { return _endOfWord; }
+		// setter for end of word flag
+		void SetEndOfWord() { _endOfWord = true; }
+		// id of the word ending at this node. Only valid if IsEndOfWord().
+		unsigned int GetWordId() const { return _wordId; }
+		void SetWordId( unsigned int wordId ) { _wordId = wordId; }
+
+		// starts loading the table ahead of a FindNode()
+		void PrefetchChildren() const
+		{
+			TRIE_PREFETCH(_children);
+		}
+		// FindNode searches child nodes for
+		// a particular DenseTrieNode
+		DenseTrieNode* FindNode( CharType c ) const
+		{
+			if (_children)
+			{
+				// characters below the table wrap round to large offsets
+				const UnsignedChar offset = static_cast<UnsignedChar>(static_cast<UnsignedChar>(c) - _children->_low);
+				if (offset < _children->_size)
+				{
+					return _children->_slots[offset];
+				}
+			}
+			return NULL;
+		}
+#ifdef TRIE_STATS
+		// no comparisons are made, provided for TRIE_STATS builds
+		DenseTrieNode* FindNode( CharType c, size_t& ) const
+		{
+			return FindNode(c);
+		}
+#endif
+
+	private:
+		DenseTrieNode& operator=(const DenseTrieNode& rhs);
+		DenseTrieNode(const DenseTrieNode& rhs);
+
+		typedef typename std::make_unsigned<CharType>::type UnsignedChar;
+
+		// one slot per character from _low to _low + _size - 1, NULL where
+		// there is no child. _packed is set when Trie::Relayout() put the
+		// table in its arena, it is not freed.
+		struct Children
+		{
+			UnsignedChar _low;
+			bool _packed;
+			unsigned int _size;
+			unsigned int _count;
+			DenseTrieNode* _slots[1];
+		};
+
+		static size_t ChildrenSize( size_t size )
+		{
+			return sizeof(Children) + (size - 1) * sizeof(DenseTrieNode*);
+		}
+		static Children* AllocateChildren( UnsignedChar low, size_t size )
+		{
+			Children* children = static_cast<Children*>(::operator new(ChildrenSize(size)));
+			children->_low = low;
+			children->_packed = false;
+			children->_size = static_cast<unsigned int>(size);
+			children->_count = 0;
+			std::fill(children->_slots, children->_slots + size, static_cast<DenseTrieNode*>(NULL));
+			return children;
+		}
+		static void FreeChildren( Children* children )
+		{
+			if (children && !children->_packed)
+			{
+				::operator delete(children);
+			}
+		}
+
+	protected:
+		Children* _children;
+		CharType _c;
+		bool _endOfWord;
+		unsigned int _wordId;
+};
+
+}
+#endif
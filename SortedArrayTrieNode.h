@@ -0,0 +1,324 @@
+// This source was written by Stephen Oswin, and is placed in the
+// public domain. The author hereby disclaims copyright to this source
+// code.
+
+#ifndef __SORTEDARRAYTRIENODE_H
+#define __SORTEDARRAYTRIENODE_H
+
+#include <new>
+
+#include "Trie.h"
+
+namespace TDS
+{
+
+// Trie node that keeps its children in two parallel sorted arrays in one
+// allocation: the child pointers, then the characters. FindNode() only
+// reads the characters, which are contiguous, so a lookup touches one or
+// two cache lines instead of dereferencing each child it compares with
+// as TrieNode does. Small nodes are scanned, larger ones binary searched.
+// The arrays grow by doubling and Compress() trims them. A node is 16
+// bytes for Trie<char>, plus 16 + 9 per child when it has children.
+// Use it as Trie<CharType,SortedArrayTrieNode<CharType> >.
+template<typename CharType>
+class SortedArrayTrieNode
+{
+	public:
+		SortedArrayTrieNode (CharType c) : _children(NULL), _c(c), _endOfWord(false), _wordId(0) {}
+		~SortedArrayTrieNode()
+		{
+			for( size_t i =  0; i < GetChildCount(); ++i)
+			{
+				delete _children->_nodes[i];
+			}
+			FreeChildren(_children);
+		}
+
+		// Gets the character for the node
+		CharType GetChar() const { return _c; }
+
+		// trims the arrays to the number of children, all the way down
+		void Compress()
+		{
+			if (_children && _children->_capacity > _children->_count)
+			{
+				Resize(_children->_count);
+			}
+			for( size_t i =  0; i < GetChildCount(); ++i)
+			{
+				_children->_nodes[i]->Compress();
+			}
+		}
+
+		// deep copy of this node and everything below it
+		SortedArrayTrieNode* Clone() const
+		{
+			SortedArrayTrieNode* newNode = new SortedArrayTrieNode(_c);
+			newNode->_endOfWord = _endOfWord;
+			newNode->_wordId = _wordId;
+			if (_children)
+			{
+				const size_t count = GetChildCount();
+				newNode->_children = AllocateChildren(count);
+				newNode->_children->_count = static_cast<unsigned int>(count);
+				std::copy(Labels(), Labels() + count, newNode->Labels());
+				for( size_t i =  0; i < count; ++i)
+				{
+					newNode->_children->_nodes[i] = _children->_nodes[i]->Clone();
+				}
+			}
+			return newNode;
+		}
+
+		// bytes needed to hold the arrays with no spare room, see CopyTo()
+		size_t GetPackedSize() const
+		{
+			return _children ? ChildrenSize(_children->_count) : 0;
+		}
+		// shallow copy of this node into place with its arrays at children,
+		// which the copy does not own, holding newChildren in place of this
+		// node's children. See TrieNode::CopyTo().
+		SortedArrayTrieNode* CopyTo( void* place, void* children, SortedArrayTrieNode* const* newChildren ) const
+		{
+			SortedArrayTrieNode* newNode = new (place) SortedArrayTrieNode(_c);
+			newNode->_endOfWord = _endOfWord;
+			newNode->_wordId = _wordId;
+			if (_children)
+			{
+				const size_t count = GetChildCount();
+				newNode->_children = static_cast<Children*>(children);
+				newNode->_children->_count = _children->_count;
+				newNode->_children->_capacity = _children->_count;
+				newNode->_children->_packed = true;
+				std::copy(newChildren, newChildren + count, newNode->_children->_nodes);
+				std::copy(Labels(), Labels() + count, newNode->Labels());
+			}
+			return newNode;
+		}
+
+		// invariant
+		bool ValidateState() const
+		{
+			if (_children)
+			{
+				// the characters must be sorted with no duplicates and
+				// match the nodes they are filed with
+				if (0==GetChildCount())
+				{
+					return false;
+				}
+				for( size_t i =  0; i < GetChildCount(); ++i)
+				{
+					const SortedArrayTrieNode* child = _children->_nodes[i];
+					if (Labels()[i] != child->GetChar() || (i && !(Labels()[i-1] < Labels()[i])) ||
+						false==child->ValidateState())
+					{
+						return false;
+					}
+				}
+			}
+			else if (!this->IsEndOfWord())
+			{
+				return false;
+			}
+			return true;
+		}
+
+		// AddNode adds a new node. Returns NULL if there already is a child
+		// for c.
+		SortedArrayTrieNode* AddNode (CharType c)
+		{
+			if (FindNode(c))
+			{
+				return NULL;
+			}
+			SortedArrayTrieNode* newNode = new SortedArrayTrieNode(c);
+			AttachNode(newNode);
+			return newNode;
+		}
+
+		// AttachNode adds an existing node as a child, keeping the arrays in
+		// order. The node must not duplicate an existing child.
+		void AttachNode( SortedArrayTrieNode* node, size_t expectedChildren = 0 )
+		{
+			const size_t count = GetChildCount();
+			if (NULL==_children || count==_children->_capacity)
+			{
+				Resize(std::max(std::max(count * 2, expectedChildren), size_t(1)));
+			}
+			size_t comparisons = 0;
+			const size_t index = LowerBound(node->GetChar(), comparisons);
+			CharType* labels = Labels();
+			std::copy_backward(_children->_nodes + index, _children->_nodes + count, _children->_nodes + count + 1);
+			std::copy_backward(labels + index, labels + count, labels + count + 1);
+			_children->_nodes[index] = node;
+			labels[index] = node->GetChar();
+			++_children->_count;
+		}
+
+		// Destroys the children of a node graph that was relaid out into a
+		// single allocation. See TrieNode::DestroyArena().
+		void DestroyArena( const SortedArrayTrieNode* arenaBegin, const SortedArrayTrieNode* arenaEnd )
+		{
+			std::less<const SortedArrayTrieNode*> lessThan;
+			for( size_t i =  0; i < GetChildCount(); ++i)
+			{
+				SortedArrayTrieNode* child = _children->_nodes[i];
+				if (!lessThan(child, arenaBegin) && lessThan(child, arenaEnd))
+				{
+					child->DestroyArena(arenaBegin, arenaEnd);
+					child->~SortedArrayTrieNode();
+				}
+				else
+				{
+					delete child;
+				}
+			}
+			FreeChildren(_children);
+			_children = NULL;
+		}
+
+		// forgets the children without deleting them, once they have been
+		// attached to another node
+		void DetachChildren()
+		{
+			FreeChildren(_children);
+			_children = NULL;
+		}
+
+		// number of child nodes
+		size_t GetChildCount() const { return _children ? _children->_count : 0; }
+		// child node at index i. Children are in alphabetical order.
+		const SortedArrayTrieNode* GetChild( size_t i ) const { return _children->_nodes[i]; }
+		// indicates this is an end node (ie no child nodes)
+		bool IsEndNode() const  { return NULL==_children; }
+		// indicates this node terminates a word
+		bool IsEndOfWord() const  { return _endOfWord; }
+		// setter for end of word flag
+		void SetEndOfWord() { _endOfWord = true; }
+		// id of the word ending at this node. Only valid if IsEndOfWord().
+		unsigned int GetWordId() const { return _wordId; }
+		void SetWordId( unsigned int wordId ) { _wordId = wordId; }
+
+		// starts loading the child arrays ahead of a FindNode()
+		void PrefetchChildren() const
+		{
+			TRIE_PREFETCH(_children);
+		}
+		// FindNode searches child nodes for
+		// a particular SortedArrayTrieNode
+		SortedArrayTrieNode* FindNode( CharType c ) const
+		{
+			size_t comparisons = 0;
+			return FindNode(c, comparisons);
+		}
+		// FindNode that adds the number of comparisons made to comparisons
+		SortedArrayTrieNode* FindNode( CharType c, size_t& comparisons ) const
+		{
+			if (_children)
+			{
+				const size_t index = LowerBound(c, comparisons);
+				if (index < _children->_count && Labels()[index] == c)
+				{
+					return _children->_nodes[index];
+				}
+			}
+			return NULL;
+		}
+
+	private:
+		SortedArrayTrieNode& operator=(const SortedArrayTrieNode& rhs);
+		SortedArrayTrieNode(const SortedArrayTrieNode& rhs);
+
+		// up to this many children are scanned rather than binary searched
+		static const size_t ScanLimit = 16;
+
+		// _capacity node pointers followed by _capacity characters, the
+		// first _count of each in use. _packed is set when Trie::Relayout()
+		// put the arrays in its arena, they are not freed and are full.
+		struct Children
+		{
+			unsigned int _count;
+			unsigned int _capacity;
+			bool _packed;
+			SortedArrayTrieNode* _nodes[1];
+		};
+
+		static size_t ChildrenSize( size_t capacity )
+		{
+			return sizeof(Children) + (capacity - 1) * sizeof(SortedArrayTrieNode*) + capacity * sizeof(CharType);
+		}
+		static Children* AllocateChildren( size_t capacity )
+		{
+			Children* children = static_cast<Children*>(::operator new(ChildrenSize(capacity)));
+			children->_count = 0;
+			children->_capacity = static_cast<unsigned int>(capacity);
+			children->_packed = false;
+			return children;
+		}
+		static void FreeChildren( Children* children )
+		{
+			if (children && !children->_packed)
+			{
+				::operator delete(children);
+			}
+		}
+
+		CharType* Labels() const
+		{
+			return reinterpret_cast<CharType*>(_children->_nodes + _children->_capacity);
+		}
+
+		// moves the children to arrays of the given capacity
+		void Resize( size_t capacity )
+		{
+			Children* children = AllocateChildren(capacity);
+			if (_children)
+			{
+				children->_count = _children->_count;
+				std::copy(_children->_nodes, _children->_nodes + _children->_count, children->_nodes);
+				std::copy(Labels(), Labels() + _children->_count, reinterpret_cast<CharType*>(children->_nodes + capacity));
+				FreeChildren(_children);
+			}
+			_children = children;
+		}
+
+		// index of the first child not less than c
+		size_t LowerBound( CharType c, size_t& comparisons ) const
+		{
+			const CharType* labels = Labels();
+			size_t first = 0;
+			size_t count = _children->_count;
+			if (count <= ScanLimit)
+			{
+				for (; first < count && (++comparisons, labels[first] < c); ++first)
+				{
+				}
+				return first;
+			}
+			while (count > 0)
+			{
+				const size_t half = count / 2;
+				++comparisons;
+				if (labels[first + half] < c)
+				{
+					first += half + 1;
+					count -= half + 1;
+				}
+				else
+				{
+					count = half;
+				}
+			}
+			return first;
+		}
+
+	protected:
+		Children* _children;
+		CharType _c;
+		bool _endOfWord;
+		unsigned int _wordId;
+};
+
+}
+#endif
@@ -0,0 +1,142 @@
+// This source was written by Stephen Oswin, and is placed in the
+// public domain. The author hereby disclaims copyright to this source
+// code.
+
+#ifndef __STATICTRIE_H
+#define __STATICTRIE_H
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "Trie.h"
+
+namespace TDS
+{
+
+// A node of a flattened trie. The nodes live in a single array with
+// node 0 as the root. The children of a node are stored next to each
+// other in alphabetical order starting at _firstChild. Being a plain
+// aggregate it can be declared constexpr, so a table produced by
+// trie_gen needs no heap and no startup code.
+template<typename CharType>
+struct StaticTrieNode
+{
+	CharType _c;
+	bool _endOfWord;
+	unsigned int _firstChild;
+	unsigned int _childCount;
+
+	// Gets the character for the node
+	constexpr CharType GetChar() const { return _c; }
+	// indicates this node terminates a word
+	constexpr bool IsEndOfWord() const { return _endOfWord; }
+	// indicates this is an end node (ie no child nodes)
+	constexpr bool IsEndNode() const { return 0==_childCount; }
+};
+
+// Read only trie over a table of StaticTrieNodes. Search() has the same
+// semantics as Trie::Search(). The handle in each SearchResult points at
+// the matching node in the table, GetNodeIndex() converts it to an index.
+template<typename CharType>
+class StaticTrie
+{
+	public:
+		constexpr StaticTrie( const StaticTrieNode<CharType>* nodes, size_t nodeCount )
+			: _nodes(nodes), _nodeCount(nodeCount)
+		{
+		}
+
+		// See Trie::Search()
+		void Search(const CharType* buffStart,
+					const CharType* buffEnd,
+					std::vector<SearchResult<CharType> >& searchResults,
+					bool stopAtFirstMatch = false) const
+		{
+			const StaticTrieNode<CharType> * pTN = _nodes;
+			const CharType* buff = buffStart;
+
+			while (buff <= buffEnd)
+			{
+				pTN = FindNode(pTN, *buff);
+				if (NULL == pTN)
+				{
+					return;
+				}
+				else if (pTN->IsEndOfWord())
+				{
+					SearchResult<CharType> st(pTN,buff);
+					searchResults.push_back(st);
+
+					if (stopAtFirstMatch)
+					{
+						return;
+					}
+				}
+				buff++;
+			}
+		}
+
+		// FindNode searches the children of pTN for c
+		const StaticTrieNode<CharType>* FindNode( const StaticTrieNode<CharType>* pTN, CharType c ) const
+		{
+			const StaticTrieNode<CharType>* first = _nodes + pTN->_firstChild;
+			const StaticTrieNode<CharType>* last = first + pTN->_childCount;
+			const StaticTrieNode<CharType>* i = std::lower_bound(first, last, c, LessThanOtron<StaticTrieNode<CharType>,CharType>());
+			if ((i!=last) && (i->GetChar()==c))
+			{
+				return i;
+			}
+			return NULL;
+		}
+
+		// converts a handle returned in a SearchResult into a node index
+		size_t GetNodeIndex( const void* handle ) const
+		{
+			return static_cast<const StaticTrieNode<CharType>*>(handle) - _nodes;
+		}
+
+		constexpr size_t GetNodeCount() const { return _nodeCount; }
+
+	protected:
+		const StaticTrieNode<CharType>* _nodes;
+		size_t _nodeCount;
+};
+
+// Flattens a Trie into breadth first ordered StaticTrieNodes. If handles
+// is not NULL it receives the node index of every word, keyed by the
+// handle AddWord() returned for it.
+template<typename CharType>
+void FlattenTrie( const Trie<CharType>& t,
+				  std::vector<StaticTrieNode<CharType> >& nodes,
+				  std::map<const void*,unsigned int>* handles = NULL )
+{
+	std::vector<const TrieNode<CharType>*> queue;
+	queue.push_back(t.GetRootNode());
+	nodes.clear();
+
+	// queue[i] becomes nodes[i]. Each node's children are appended to the
+	// queue together so they end up contiguous in the table.
+	for (size_t i = 0; i < queue.size(); ++i)
+	{
+		const TrieNode<CharType>* pTN = queue[i];
+		StaticTrieNode<CharType> n;
+		n._c = pTN->GetChar();
+		n._endOfWord = pTN->IsEndOfWord();
+		n._firstChild = static_cast<unsigned int>(queue.size());
+		n._childCount = static_cast<unsigned int>(pTN->GetChildCount());
+		nodes.push_back(n);
+
+		if (handles && pTN->IsEndOfWord())
+		{
+			(*handles)[pTN] = static_cast<unsigned int>(i);
+		}
+		for (size_t c = 0; c < pTN->GetChildCount(); ++c)
+		{
+			queue.push_back(pTN->GetChild(c));
+		}
+	}
+}
+
+}
+#endif
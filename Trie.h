@@ -5,8 +5,32 @@
 #ifndef __TRIE_H
 #define __TRIE_H
 
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <new>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
+#ifdef TRIE_STATS
+#include <chrono>
+#endif
+
+// TRIE_STATS_ONLY() wraps code that is only compiled in when TRIE_STATS
+// is defined, so the instrumentation costs nothing in normal builds.
+#ifdef TRIE_STATS
+#define TRIE_STATS_ONLY(...) __VA_ARGS__
+#else
+#define TRIE_STATS_ONLY(...)
+#endif
+
+// hint that the memory at p will be read soon
+#if defined(__GNUC__)
+#define TRIE_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define TRIE_PREFETCH(p)
+#endif
 
 namespace TDS
 {
@@ -23,77 +47,182 @@ struct LessThanOtron
 	{
 		return(lhs < rhs->GetChar());
 	}
+	// overloads for nodes stored by value (see StaticTrie.h)
+	bool operator()( const TrieNodeType& lhs, const CharType rhs ) const
+	{
+		return(lhs.GetChar() < rhs);
+	}
+	bool operator()( const CharType lhs, const TrieNodeType& rhs ) const
+	{
+		return(lhs < rhs.GetChar());
+	}
 };
 
+#ifdef TRIE_STATS
+// LessThanOtron that counts how many comparisons lower_bound() made
+template <class TrieNodeType, typename CharType>
+struct CountingLessThanOtron
+{
+	explicit CountingLessThanOtron( size_t& comparisons ) : _comparisons(comparisons) {}
+	bool operator()( const TrieNodeType* lhs, const CharType rhs ) const
+	{
+		++_comparisons;
+		return(lhs->GetChar() < rhs);
+	}
+	bool operator()( const CharType lhs, const TrieNodeType* rhs ) const
+	{
+		++_comparisons;
+		return(lhs < rhs->GetChar());
+	}
+	size_t& _comparisons;
+};
+#endif
+
+// Counters filled in once a TrieStats has been given to Trie::SetStats().
+// Both forms of Search(), SearchTagged() and Count() count as searches,
+// AddWord() and AddTaggedWord() as adds. Contains(), LongestPrefix(), the
+// batch lookups and TrieScanner are not counted. They are only collected
+// when TRIE_STATS is defined, otherwise the calls compile to nothing.
+struct TrieStats
+{
+	TrieStats() { Clear(); }
+	void Clear()
+	{
+		_searchCalls = 0;
+		_addWordCalls = 0;
+		_charactersExamined = 0;
+		_nodeVisits = 0;
+		_comparisons = 0;
+		_matches = 0;
+		_maxDepth = 0;
+		_searchNanoseconds = 0;
+		_addWordNanoseconds = 0;
+	}
+
+	size_t _searchCalls;
+	size_t _addWordCalls;
+	// characters looked up in a node's children
+	size_t _charactersExamined;
+	// lookups that found a child node
+	size_t _nodeVisits;
+	// comparisons made by the lower_bound() in FindNode()
+	size_t _comparisons;
+	// results produced by Search()
+	size_t _matches;
+	// deepest node reached
+	size_t _maxDepth;
+	unsigned long long _searchNanoseconds;
+	unsigned long long _addWordNanoseconds;
+};
+
+#ifdef TRIE_STATS
+// Counts and times a single Search() or AddWord() call. The time and
+// depth are recorded when it goes out of scope.
+class TrieStatsScope
+{
+	public:
+		TrieStatsScope( TrieStats* stats, size_t TrieStats::* calls, unsigned long long TrieStats::* nanoseconds )
+			: _stats(stats), _nanoseconds(nanoseconds), _depth(0)
+		{
+			if (_stats)
+			{
+				++(_stats->*calls);
+				_start = std::chrono::steady_clock::now();
+			}
+		}
+		~TrieStatsScope()
+		{
+			if (_stats)
+			{
+				_stats->*_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count();
+				_stats->_maxDepth = std::max(_stats->_maxDepth, _depth);
+			}
+		}
+		void SetDepth( size_t depth ) { _depth = depth; }
+
+	private:
+		TrieStats* _stats;
+		unsigned long long TrieStats::* _nanoseconds;
+		size_t _depth;
+		std::chrono::steady_clock::time_point _start;
+};
+#endif
+
 // Trie Node
 template<typename CharType>
 class TrieNode
 {
 	public:
-		TrieNode (CharType c) : _c(c), _endOfWord(false), _childNodes(NULL) {}
+		TrieNode (CharType c) : _children(NULL), _word(0), _c(c) {}
 		~TrieNode()
 		{
-			if (_childNodes)
+			for( size_t i =  0; i < GetChildCount(); ++i)
 			{
-				for( size_t i =  0; i < _childNodes->size(); ++i)
-				{
-					delete _childNodes->at(i);
-				}
-				delete _childNodes;
+				delete _children->_nodes[i];
 			}
+			FreeChildren(_children);
 		}
 
 		// Gets the character for the node
 		CharType GetChar() const { return _c; }
 
-		// compress shrinks down all the vectors
+		// compress trims all the child lists to size
+		// this call is recursive
 		void Compress()
 		{
-			if (_childNodes && !_childNodes->empty())
+			if (_children && Capacity() > _children->_count)
+			{
+				Resize(_children->_count);
+			}
+			for( size_t i =  0; i < GetChildCount(); ++i)
+			{
+				// recurse down the tree and call Compress
+				_children->_nodes[i]->Compress();
+			}
+		}
+
+		// deep copy of this node and everything below it. Each child
+		// list is allocated once at its final size.
+		TrieNode* Clone() const
+		{
+			TrieNode* newNode = new TrieNode(_c);
+			newNode->_word = _word;
+			if (_children)
 			{
-				_childNodes->shrink_to_fit();
-				typename std::vector<TrieNode*>::const_iterator i = _childNodes->begin();
-				for (; i != _childNodes->end() ; ++i) 
+				newNode->Resize(_children->_count);
+				for( size_t i =  0; i < _children->_count; ++i)
 				{
-					// recurse down the tree and call Compress
-					(*i)->Compress();
+					newNode->_children->_nodes[i] = _children->_nodes[i]->Clone();
 				}
+				newNode->_children->_count = _children->_count;
 			}
+			return newNode;
 		}
 
 		// invariant
 		bool ValidateState() const
 		{
-			// if we have a childnodes vector it should never be empty
-			if (_childNodes && _childNodes->empty())
+			// if we have a child list it should never be empty
+			if (_children && 0 == _children->_count)
 			{
 				return false;
 			}
 
-			if (_childNodes)
+			if (_children)
 			{
 				// check child nodes are sorted AND there are NO duplicates
-				typename std::vector<TrieNode*>::const_iterator i = _childNodes->begin();
-
-				CharType lastChar = (*i)->GetChar();
-				if (false==(*i)->ValidateState())
-				{
-					return false;
-				}
-				++i;
-				for (; i != _childNodes->end() ; ++i) 
+				for( size_t i =  0; i < _children->_count; ++i)
 				{
 					// recurse down the tree and call validate
-					if (false==(*i)->ValidateState())
+					if (false==_children->_nodes[i]->ValidateState())
 					{
 						return false;
 					}
 
-					if( lastChar > (*i)->GetChar() )
+					if( i && !(_children->_nodes[i-1]->GetChar() < _children->_nodes[i]->GetChar()) )
 					{
 						return false;
 					}
-					lastChar = (*i)->GetChar();
 				}
 			}
 			else if (!this->IsEndOfWord())
@@ -103,48 +232,124 @@ class TrieNode
 
 			return true;
 		}
-		// AddNode adds a new node. This function
-		// must keep the node list in alphabetical order.
-		TrieNode* AddNode (CharType c) 
+		// bytes needed to hold the child list with no spare room, see
+		// CopyTo()
+		size_t GetPackedSize() const
+		{
+			return _children ? ChildrenSize(_children->_count) : 0;
+		}
+		// shallow copy of this node into place: the character, word flag
+		// and id. Its child list is put at children, GetPackedSize() bytes
+		// that the copy does not own, and holds newChildren, which replace
+		// this node's children in the same order. Used by Trie::Relayout().
+		TrieNode* CopyTo( void* place, void* children, TrieNode* const* newChildren ) const
 		{
-			if (NULL==_childNodes)
+			TrieNode* newNode = new (place) TrieNode(_c);
+			newNode->_word = _word;
+			if (_children)
 			{
-				_childNodes = new std::vector<TrieNode*>;
+				newNode->_children = static_cast<Children*>(children);
+				newNode->_children->_count = _children->_count;
+				newNode->_children->_capacity = _children->_count | PackedBit;
+				std::copy(newChildren, newChildren + _children->_count, newNode->_children->_nodes);
 			}
-			TrieNode* newNode = NULL;
+			return newNode;
+		}
 
-			typename std::vector<TrieNode*>::iterator i = std::lower_bound(_childNodes->begin(), _childNodes->end(), c, LessThanOtron<TrieNode,CharType>());
-			
-			if (i == _childNodes->end())
+		// AttachNode adds an existing node as a child, keeping the list in
+		// alphabetical order. The node must not duplicate an existing child.
+		// Attaching in alphabetical order just appends.
+		void AttachNode( TrieNode* node, size_t expectedChildren = 0 )
+		{
+			const size_t count = GetChildCount();
+			if (NULL==_children || count >= Capacity())
+			{
+				Resize(std::max(std::max(count * 2, expectedChildren), size_t(1)));
+			}
+			size_t index = count;
+			if (count && !(_children->_nodes[count-1]->GetChar() < node->GetChar()))
 			{
-				newNode = new TrieNode(c);
-				_childNodes->push_back(newNode);
-				return newNode;
+				index = std::lower_bound(_children->_nodes, _children->_nodes + count, node->GetChar(), LessThanOtron<TrieNode,CharType>()) - _children->_nodes;
+			}
+			std::copy_backward(_children->_nodes + index, _children->_nodes + count, _children->_nodes + count + 1);
+			_children->_nodes[index] = node;
+			++_children->_count;
+		}
+
+		// Destroys the children of a node graph that was relaid out into a
+		// single allocation (see Trie::Relayout()). Nodes between arenaBegin
+		// and arenaEnd are destroyed in place and their memory left for the
+		// owner of the allocation, nodes added since were allocated
+		// individually and are deleted.
+		void DestroyArena( const TrieNode* arenaBegin, const TrieNode* arenaEnd )
+		{
+			std::less<const TrieNode*> lessThan;
+			for( size_t i =  0; i < GetChildCount(); ++i)
+			{
+				TrieNode* child = _children->_nodes[i];
+				if (!lessThan(child, arenaBegin) && lessThan(child, arenaEnd))
+				{
+					child->DestroyArena(arenaBegin, arenaEnd);
+					child->~TrieNode();
+				}
+				else
+				{
+					delete child;
+				}
 			}
-			else if ((*i)->GetChar()==c)
+			FreeChildren(_children);
+			_children = NULL;
+		}
+
+		// forgets the children without deleting them, once they have been
+		// attached to another node
+		void DetachChildren()
+		{
+			FreeChildren(_children);
+			_children = NULL;
+		}
+
+		// AddNode adds a new node. This function
+		// must keep the node list in alphabetical order.
+		TrieNode* AddNode (CharType c) 
+		{
+			if (FindNode(c))
 			{
 				// duplicate node? Hopefully this wont happen...
 				return NULL;
 			}
-			newNode = new TrieNode(c);
-			// now insert just before i
-			_childNodes->insert (i, newNode);
+			TrieNode* newNode = new TrieNode(c);
+			AttachNode(newNode);
 			return newNode;
 		}
+		// number of child nodes
+		size_t GetChildCount() const { return _children ? _children->_count : 0; }
+		// child node at index i. Children are in alphabetical order.
+		const TrieNode* GetChild( size_t i ) const { return _children->_nodes[i]; }
 		// indicates this is an end node (ie no child nodes)
-		bool IsEndNode() const  { return NULL==_childNodes; }
+		bool IsEndNode() const  { return NULL==_children; }
 		// indicates this node terminates a word
-		bool IsEndOfWord() const  { return _endOfWord; }
+		bool IsEndOfWord() const  { return 0 != (_word & EndOfWordBit); }
 		// setter for end of word flag
-		void SetEndOfWord() { _endOfWord = true; }
+		void SetEndOfWord() { _word |= EndOfWordBit; }
+		// id of the word ending at this node. Only valid if IsEndOfWord().
+		unsigned int GetWordId() const { return _word & ~EndOfWordBit; }
+		void SetWordId( unsigned int wordId ) { _word = (_word & EndOfWordBit) | wordId; }
+		// starts loading the child list ahead of a FindNode()
+		void PrefetchChildren() const
+		{
+			TRIE_PREFETCH(_children);
+		}
 		// FindNode searches child nodes for
 		// a particular TrieNode
 		const TrieNode* FindNode( CharType c ) const
 		{
-			if (_childNodes)
+			if (_children)
 			{
-				typename std::vector<TrieNode*>::const_iterator i = std::lower_bound(_childNodes->begin(), _childNodes->end(), c, LessThanOtron<TrieNode,CharType>());
-				if ((i!=_childNodes->end()) && ((*i)->GetChar()==c))
+				TrieNode* const* begin = _children->_nodes;
+				TrieNode* const* end = begin + _children->_count;
+				TrieNode* const* i = std::lower_bound(begin, end, c, LessThanOtron<TrieNode,CharType>());
+				if ((i!=end) && ((*i)->GetChar()==c))
 				{
 					return *i;
 				}
@@ -155,30 +360,100 @@ class TrieNode
 		// Un-const overload of above
 		TrieNode* FindNode( CharType c )
 		{
-			if (_childNodes)
+			return const_cast<TrieNode*>(static_cast<const TrieNode*>(this)->FindNode(c));
+		}
+#ifdef TRIE_STATS
+		// FindNode that adds the number of comparisons made to comparisons
+		const TrieNode* FindNode( CharType c, size_t& comparisons ) const
+		{
+			if (_children)
 			{
-				typename std::vector<TrieNode*>::iterator i = std::lower_bound(_childNodes->begin(), _childNodes->end(), c, LessThanOtron<TrieNode,CharType>());
-				if ((i!=_childNodes->end()) && ((*i)->GetChar()==c))
+				TrieNode* const* begin = _children->_nodes;
+				TrieNode* const* end = begin + _children->_count;
+				TrieNode* const* i = std::lower_bound(begin, end, c, CountingLessThanOtron<TrieNode,CharType>(comparisons));
+				if ((i!=end) && ((*i)->GetChar()==c))
 				{
 					return *i;
 				}
 			}
 			return NULL;
 		}
+
+		// Un-const overload of above
+		TrieNode* FindNode( CharType c, size_t& comparisons )
+		{
+			return const_cast<TrieNode*>(static_cast<const TrieNode*>(this)->FindNode(c, comparisons));
+		}
+#endif
 	private:
 		TrieNode& operator=(const TrieNode& rhs);
 		TrieNode(const TrieNode& rhs);
 
+		// the end of word flag is kept in the top bit of the word id, so
+		// ids are 31 bits. With the pointer first there is no padding: 16
+		// bytes on 64 bit platforms for char and wchar_t alike
+		static const unsigned int EndOfWordBit = 1u << 31;
+		// set in _capacity for a child list that Trie::Relayout() packed
+		// into its arena. The node does not free it, and moves the
+		// children to a list of its own before adding another.
+		static const unsigned int PackedBit = 1u << 31;
+
+		// the child count and capacity followed by the child pointers, in
+		// one allocation so a lookup loads one block rather than a vector
+		// and then its buffer
+		struct Children
+		{
+			unsigned int _count;
+			unsigned int _capacity;
+			TrieNode* _nodes[1];
+		};
+
+		static size_t ChildrenSize( size_t capacity )
+		{
+			return sizeof(Children) + (capacity - 1) * sizeof(TrieNode*);
+		}
+		static void FreeChildren( Children* children )
+		{
+			if (children && 0 == (children->_capacity & PackedBit))
+			{
+				::operator delete(children);
+			}
+		}
+		// room in the child list. A packed list has none to spare.
+		size_t Capacity() const
+		{
+			return (_children->_capacity & PackedBit) ? 0 : _children->_capacity;
+		}
+
+		// moves the children to a list of the given capacity
+		void Resize( size_t capacity )
+		{
+			Children* children = static_cast<Children*>(::operator new(ChildrenSize(capacity)));
+			children->_count = 0;
+			children->_capacity = static_cast<unsigned int>(capacity);
+			if (_children)
+			{
+				children->_count = _children->_count;
+				std::copy(_children->_nodes, _children->_nodes + _children->_count, children->_nodes);
+				FreeChildren(_children);
+			}
+			_children = children;
+		}
+
 	protected:
+		Children* _children;
+		unsigned int _word;
 		CharType _c;
-		std::vector<TrieNode*>* _childNodes;
-		bool _endOfWord;
 };
 
 template<typename CharType>
 class SearchResult
 {
 	public:
+		SearchResult()
+			: _result(NULL), _position(NULL)
+		{
+		}
 		SearchResult( const void * result, const CharType * position )
 			: _result(result), _position(position)
 		{
@@ -199,12 +474,294 @@ class SearchResult
 		const CharType * _position;
 };
 
+// Fixed capacity ring of search results in storage supplied by the caller,
+// for the bounded Trie::Search() and TrieScanner::Step(). Nothing is
+// allocated however many matches a search finds. When the ring is full
+// StopWhenFull ends the search and OverwriteOldest keeps the newest
+// results. Either way IsTruncated() reports that results were lost or a
+// search was cut short by its match or character cap. A ring with a
+// capacity of 0 holds nothing: a StopWhenFull one is always full.
 template<typename CharType>
+class BoundedSearchResults
+{
+	public:
+		enum Policy
+		{
+			StopWhenFull,
+			OverwriteOldest
+		};
+
+		BoundedSearchResults( SearchResult<CharType>* storage, size_t capacity, Policy policy = StopWhenFull )
+			: _storage(storage), _capacity(capacity), _policy(policy),
+			  _first(0), _size(0), _dropped(0), _truncated(false)
+		{
+		}
+
+		// Adds a result. Returns false if it did not fit and the search
+		// should stop, which only happens with StopWhenFull.
+		bool Add( const SearchResult<CharType>& result )
+		{
+			if (_size < _capacity)
+			{
+				_storage[Slot(_size)] = result;
+				++_size;
+				return true;
+			}
+			++_dropped;
+			_truncated = true;
+			if (OverwriteOldest == _policy && _capacity)
+			{
+				_storage[_first] = result;
+				_first = Slot(1);
+				return true;
+			}
+			return false;
+		}
+
+		// result i, oldest first. i must be less than GetSize().
+		const SearchResult<CharType>& operator[]( size_t i ) const
+		{
+			return _storage[Slot(i)];
+		}
+		// removes the oldest result, so a consumer can drain the ring
+		// while a TrieScanner fills it. Does nothing if the ring is empty.
+		void PopFront()
+		{
+			if (_size)
+			{
+				_first = Slot(1);
+				--_size;
+			}
+		}
+		// empties the ring and clears the truncation state
+		void Clear()
+		{
+			_first = 0;
+			_size = 0;
+			_dropped = 0;
+			_truncated = false;
+		}
+
+		size_t GetSize() const { return _size; }
+		size_t GetCapacity() const { return _capacity; }
+		Policy GetPolicy() const { return _policy; }
+		// true if a StopWhenFull ring has no room for another result
+		bool IsFull() const { return StopWhenFull == _policy && _size == _capacity; }
+		// number of matches that were overwritten or did not fit
+		size_t GetDropped() const { return _dropped; }
+		// true if results were dropped or a search stopped at a cap
+		bool IsTruncated() const { return _truncated; }
+		void SetTruncated() { _truncated = true; }
+
+	private:
+		BoundedSearchResults& operator=(const BoundedSearchResults& rhs);
+		BoundedSearchResults(const BoundedSearchResults& rhs);
+
+		// storage index of the result i places after the oldest. i is at
+		// most _capacity so one wrap is enough, and a ring of capacity 0
+		// never gets here.
+		size_t Slot( size_t i ) const
+		{
+			const size_t slot = _first + i;
+			return (slot >= _capacity) ? slot - _capacity : slot;
+		}
+
+		SearchResult<CharType>* _storage;
+		size_t _capacity;
+		Policy _policy;
+		size_t _first;
+		size_t _size;
+		size_t _dropped;
+		bool _truncated;
+};
+
+// Match counts per word, indexed by word id (see Trie::GetWordId()).
+// Filled in by Trie::Count(). For multi threaded scans give each thread
+// its own histogram and Merge() them at the end.
+class KeywordHistogram
+{
+	public:
+		explicit KeywordHistogram( size_t wordCount = 0 ) : _counts(wordCount, 0) {}
+
+		void Add( size_t wordId ) { ++_counts[wordId]; }
+		size_t GetCount( size_t wordId ) const { return _counts[wordId]; }
+		size_t GetSize() const { return _counts.size(); }
+		void Resize( size_t wordCount ) { _counts.resize(wordCount, 0); }
+		void Clear() { std::fill(_counts.begin(), _counts.end(), 0); }
+
+		// adds the counts from other into this histogram
+		void Merge( const KeywordHistogram& other )
+		{
+			if (other._counts.size() > _counts.size())
+			{
+				Resize(other._counts.size());
+			}
+			for (size_t i = 0; i < other._counts.size(); ++i)
+			{
+				_counts[i] += other._counts[i];
+			}
+		}
+
+		// fills topN with up to n (word id, count) pairs, most frequent
+		// first. Words with no matches are left out.
+		void TopN( size_t n, std::vector<std::pair<size_t,size_t> >& topN ) const
+		{
+			topN.clear();
+			for (size_t i = 0; i < _counts.size(); ++i)
+			{
+				if (_counts[i])
+				{
+					topN.push_back(std::make_pair(i, _counts[i]));
+				}
+			}
+			n = std::min(n, topN.size());
+			std::partial_sort(topN.begin(), topN.begin()+n, topN.end(), MoreFrequent());
+			topN.resize(n);
+		}
+
+	private:
+		// orders by count descending then by word id
+		struct MoreFrequent
+		{
+			bool operator()( const std::pair<size_t,size_t>& lhs, const std::pair<size_t,size_t>& rhs ) const
+			{
+				if (lhs.second != rhs.second)
+				{
+					return lhs.second > rhs.second;
+				}
+				return lhs.first < rhs.first;
+			}
+		};
+
+		std::vector<size_t> _counts;
+};
+
+// bit mask of dictionary tags, bit n set means tag n
+typedef unsigned long long TagSet;
+
+// see TrieLoader.h
+template<typename NodeType>
+class TrieLoader;
+
+// The node type is the storage engine of a Trie. The Trie only uses the
+// members below, so any class that has them can be plugged in:
+//   lookup:  FindNode(c) const returning the child for c or NULL,
+//            IsEndOfWord(), GetWordId(), PrefetchChildren(), and in
+//            TRIE_STATS builds FindNode(c, size_t& comparisons)
+//   build:   a constructor from the character, AddNode(c) returning NULL
+//            if c is already a child, non const FindNode(c),
+//            SetEndOfWord(), SetWordId(), AttachNode(node, expected
+//            children) and Compress()
+//   walking: GetChar(), GetChildCount(), GetChild(i) (in any fixed
+//            order), IsEndNode() and ValidateState()
+//   copying: Clone(), GetPackedSize(), CopyTo(place, children, new
+//            children), DestroyArena(begin, end) and DetachChildren()
+// IsTrieNode checks for them at compile time.
+template<typename NodeType, typename CharType>
+class IsTrieNode
+{
+	private:
+		template<typename N>
+		static char Lookup( decltype(static_cast<const N*>(std::declval<const N&>().FindNode(std::declval<CharType>())))*,
+							decltype(static_cast<bool>(std::declval<const N&>().IsEndOfWord()))*,
+							decltype(static_cast<unsigned int>(std::declval<const N&>().GetWordId()))*,
+							decltype(std::declval<const N&>().PrefetchChildren())* );
+		template<typename N>
+		static long Lookup( ... );
+
+		template<typename N>
+		static char Build( decltype(N(std::declval<CharType>()))*,
+						   decltype(static_cast<N*>(std::declval<N&>().AddNode(std::declval<CharType>())))*,
+						   decltype(static_cast<N*>(std::declval<N&>().FindNode(std::declval<CharType>())))*,
+						   decltype(std::declval<N&>().SetEndOfWord())*,
+						   decltype(std::declval<N&>().SetWordId(0u))*,
+						   decltype(std::declval<N&>().AttachNode(std::declval<N*>(), size_t()))*,
+						   decltype(std::declval<N&>().Compress())* );
+		template<typename N>
+		static long Build( ... );
+
+		template<typename N>
+		static char Walk( decltype(static_cast<CharType>(std::declval<const N&>().GetChar()))*,
+						  decltype(static_cast<size_t>(std::declval<const N&>().GetChildCount()))*,
+						  decltype(static_cast<const N*>(std::declval<const N&>().GetChild(size_t())))*,
+						  decltype(static_cast<bool>(std::declval<const N&>().IsEndNode()))*,
+						  decltype(static_cast<bool>(std::declval<const N&>().ValidateState()))* );
+		template<typename N>
+		static long Walk( ... );
+
+		template<typename N>
+		static char Copy( decltype(static_cast<N*>(std::declval<const N&>().Clone()))*,
+						  decltype(static_cast<size_t>(std::declval<const N&>().GetPackedSize()))*,
+						  decltype(static_cast<N*>(std::declval<const N&>().CopyTo(std::declval<void*>(), std::declval<void*>(), std::declval<N* const*>())))*,
+						  decltype(std::declval<N&>().DestroyArena(std::declval<const N*>(), std::declval<const N*>()))*,
+						  decltype(std::declval<N&>().DetachChildren())* );
+		template<typename N>
+		static long Copy( ... );
+
+#ifdef TRIE_STATS
+		template<typename N>
+		static char Stats( decltype(static_cast<const N*>(std::declval<const N&>().FindNode(std::declval<CharType>(), std::declval<size_t&>())))* );
+		template<typename N>
+		static long Stats( ... );
+#endif
+
+	public:
+		static const bool HasLookup = sizeof(Lookup<NodeType>(0, 0, 0, 0)) == sizeof(char)
+									  TRIE_STATS_ONLY(&& sizeof(Stats<NodeType>(0)) == sizeof(char));
+		static const bool HasBuild = sizeof(Build<NodeType>(0, 0, 0, 0, 0, 0, 0)) == sizeof(char);
+		static const bool HasWalk = sizeof(Walk<NodeType>(0, 0, 0, 0, 0)) == sizeof(char);
+		static const bool HasCopy = sizeof(Copy<NodeType>(0, 0, 0, 0, 0)) == sizeof(char);
+		static const bool value = HasLookup && HasBuild && HasWalk && HasCopy;
+};
+
+// Trie is parameterised on the node type, see IsTrieNode. TrieNode is the
+// general purpose node. BitmapTrieNode.h, SortedArrayTrieNode.h and
+// DenseTrieNode.h have other layouts, trie_bench compares them.
+template<typename CharType, typename NodeType = TrieNode<CharType> >
 class Trie
 {
+		static_assert(IsTrieNode<NodeType,CharType>::HasLookup, "NodeType needs FindNode(), IsEndOfWord(), GetWordId() and PrefetchChildren()");
+		static_assert(IsTrieNode<NodeType,CharType>::HasBuild, "NodeType needs a constructor from CharType, AddNode(), FindNode(), SetEndOfWord(), SetWordId(), AttachNode() and Compress()");
+		static_assert(IsTrieNode<NodeType,CharType>::HasWalk, "NodeType needs GetChar(), GetChildCount(), GetChild(), IsEndNode() and ValidateState()");
+		static_assert(IsTrieNode<NodeType,CharType>::HasCopy, "NodeType needs Clone(), GetPackedSize(), CopyTo(), DestroyArena() and DetachChildren()");
+
 	public:
-		Trie(){ _rootNode = new TrieNode<CharType>(0L); }
-		~Trie(){ delete _rootNode; }
+		static const size_t MaxTags = sizeof(TagSet) * 8;
+		// word ids are 31 bits, TrieNode keeps its end of word flag in the
+		// top bit of the id
+		static const size_t MaxWords = size_t(1) << 31;
+
+		Trie() : _wordCount(0), _arena(NULL), _arenaSize(0) TRIE_STATS_ONLY(, _stats(NULL)) { _rootNode = new NodeType(0L); }
+		~Trie(){ DeleteNodes(); }
+
+		// The moved from trie is left empty but usable.
+		Trie(Trie&& rhs) : _rootNode(new NodeType(0L)), _wordCount(0), _arena(NULL), _arenaSize(0) TRIE_STATS_ONLY(, _stats(NULL))
+		{
+			swap(rhs);
+		}
+		// O(1), the old contents of this trie end up in rhs.
+		Trie& operator=(Trie&& rhs)
+		{
+			swap(rhs);
+			return *this;
+		}
+		// O(1) exchange of the contents of two tries
+		void swap(Trie& rhs)
+		{
+			std::swap(_rootNode, rhs._rootNode);
+			std::swap(_wordCount, rhs._wordCount);
+			std::swap(_arena, rhs._arena);
+			std::swap(_arenaSize, rhs._arenaSize);
+			_wordTags.swap(rhs._wordTags);
+		}
+		// Deep copy. Note the handles returned by AddWord() refer to the
+		// original and will not match results from the clone.
+		Trie Clone() const
+		{
+			Trie t(_rootNode->Clone(), _wordCount);
+			t._wordTags = _wordTags;
+			return t;
+		}
 
 		// Search function. Requires pointers to the start / end of the input buffer to search.
 		// Performs a case sensitive search.
@@ -219,24 +776,27 @@ class Trie
 					std::vector<SearchResult<CharType> >& searchResults,
 					bool stopAtFirstMatch = false) const
 		{
-			const TrieNode<CharType> * pTN	= _rootNode;
+			TRIE_STATS_ONLY(TrieStatsScope scope(_stats, &TrieStats::_searchCalls, &TrieStats::_searchNanoseconds);)
+			const NodeType * pTN	= _rootNode;
 			const CharType* buff = buffStart;
 
 			while (buff <= buffEnd)
 			{
 				// look for the character in the child nodes
-				pTN = pTN->FindNode(*buff);
+				pTN = FindChild(pTN, *buff);
 				// not found
 				if (NULL == pTN)
 				{
 					return;
 				}
-				else if (pTN->IsEndOfWord())
+				TRIE_STATS_ONLY(scope.SetDepth(buff - buffStart + 1);)
+				if (pTN->IsEndOfWord())
 				{
 					// found a word, could match more though.
 					// at this point need to push result onto vector and continue...
 					SearchResult<CharType> st(pTN,buff);
 					searchResults.push_back(st);
+					TRIE_STATS_ONLY(if (_stats) ++_stats->_matches;)
 
 					// If you want to stop at the first match you can
 					// return here
@@ -255,8 +815,244 @@ class Trie
 			return;
 		}
 		
+		// Bounded version of Search(). Results go into searchResults, whose
+		// storage and capacity are fixed by the caller, so an input that
+		// matches over and over ("aaaa..." against "a", "aa", "aaa"...) can
+		// not make a search use more memory. The search also stops after
+		// maxMatches matches or maxCharacters characters looked up. If a
+		// result is lost or a cap is reached while the search could still
+		// find more, searchResults.IsTruncated() is set.
+		// Like the vector Search() this only finds words starting at
+		// buffStart, and the caps are for this one call: a caller searching
+		// from every start position gets fresh caps each time, so to bound a
+		// whole buffer pass each call what is left of the budget or use
+		// TrieScanner::Step(), whose caps cover a step across start
+		// positions.
+		// Returns the number of results this call added to searchResults,
+		// not counting a match that did not fit a StopWhenFull ring. With
+		// OverwriteOldest some of them may since have been overwritten.
+		size_t Search(const CharType* buffStart,
+					  const CharType* buffEnd,
+					  BoundedSearchResults<CharType>& searchResults,
+					  bool stopAtFirstMatch = false,
+					  size_t maxMatches = static_cast<size_t>(-1),
+					  size_t maxCharacters = static_cast<size_t>(-1)) const
+		{
+			TRIE_STATS_ONLY(TrieStatsScope scope(_stats, &TrieStats::_searchCalls, &TrieStats::_searchNanoseconds);)
+			const NodeType * pTN	= _rootNode;
+			const CharType* buff = buffStart;
+			size_t matches = 0;
+			size_t added = 0;
+
+			for (; buff <= buffEnd; ++buff)
+			{
+				if (static_cast<size_t>(buff - buffStart) >= maxCharacters)
+				{
+					searchResults.SetTruncated();
+					break;
+				}
+				pTN = FindChild(pTN, *buff);
+				if (NULL == pTN)
+				{
+					break;
+				}
+				TRIE_STATS_ONLY(scope.SetDepth(buff - buffStart + 1);)
+				if (pTN->IsEndOfWord())
+				{
+					if (matches >= maxMatches)
+					{
+						searchResults.SetTruncated();
+						break;
+					}
+					TRIE_STATS_ONLY(if (_stats) ++_stats->_matches;)
+					++matches;
+					if (!searchResults.Add(SearchResult<CharType>(pTN,buff)))
+					{
+						break;
+					}
+					++added;
+					if (stopAtFirstMatch)
+					{
+						break;
+					}
+				}
+			}
+			return added;
+		}
+
+		// Exact match. Returns the handle of the word (as AddWord() did) or
+		// NULL if it is not in the trie.
+		const void* Contains( const std::basic_string<CharType>& s ) const
+		{
+			if (!s.empty())
+			{
+				return Contains(s.c_str(), &s[s.size()-1]);
+			}
+			return NULL;
+		}
+
+		const void* Contains( const CharType* p, const CharType* end ) const
+		{
+			const NodeType * pTN = _rootNode;
+			for (; p <= end; ++p)
+			{
+				pTN = pTN->FindNode(*p);
+				if (NULL == pTN)
+				{
+					return NULL;
+				}
+			}
+			return (pTN != _rootNode && pTN->IsEndOfWord()) ? pTN : NULL;
+		}
+
+		// Longest prefix match, eg for routing tables or URL rules. Returns
+		// the handle of the longest word that the input starts with, or
+		// NULL if none. If position is not NULL it is set to the last
+		// character of the match.
+		const void* LongestPrefix( const std::basic_string<CharType>& s, const CharType** position = NULL ) const
+		{
+			if (!s.empty())
+			{
+				return LongestPrefix(s.c_str(), &s[s.size()-1], position);
+			}
+			if (position)
+			{
+				*position = NULL;
+			}
+			return NULL;
+		}
+
+		const void* LongestPrefix( const CharType* p, const CharType* end, const CharType** position = NULL ) const
+		{
+			const NodeType * pTN = _rootNode;
+			const NodeType * longest = NULL;
+			const CharType * longestEnd = NULL;
+			for (; p <= end; ++p)
+			{
+				pTN = pTN->FindNode(*p);
+				if (NULL == pTN)
+				{
+					break;
+				}
+				if (pTN->IsEndOfWord())
+				{
+					longest = pTN;
+					longestEnd = p;
+				}
+			}
+			if (position)
+			{
+				*position = longestEnd;
+			}
+			return longest;
+		}
+
+		// Batch versions of Contains() and LongestPrefix().
+		// Looks up count words at once. Word i runs from starts[i] to ends[i]
+		// inclusive, results[i] is set to its handle or to NULL if it is not
+		// in the trie. The walks are interleaved a group at a time and the
+		// next node of each is prefetched, so the cache misses of separate
+		// lookups overlap instead of happening one after another.
+		void ContainsBatch(const CharType* const* starts,
+						   const CharType* const* ends,
+						   size_t count,
+						   const void** results) const
+		{
+			FindBatch(starts, ends, count, results, NULL);
+		}
+
+		// As ContainsBatch() but results[i] is set to the longest word that
+		// is a prefix of query i, and positions[i] to the last character of
+		// that prefix. Both are NULL if no word matches.
+		void LongestPrefixBatch(const CharType* const* starts,
+								const CharType* const* ends,
+								size_t count,
+								const void** results,
+								const CharType** positions) const
+		{
+			FindBatch(starts, ends, count, results, positions);
+		}
+
+		// Tagged version of Search(). Only words carrying at least one of the
+		// tags in the tags bit mask (see AddTaggedWord()) are returned, so
+		// several dictionaries held in one trie can be searched in one pass.
+		// Use GetTags() on a result to find which dictionaries it belongs to.
+		void SearchTagged(const CharType* buffStart,
+						  const CharType* buffEnd,
+						  std::vector<SearchResult<CharType> >& searchResults,
+						  TagSet tags,
+						  bool stopAtFirstMatch = false) const
+		{
+			TRIE_STATS_ONLY(TrieStatsScope scope(_stats, &TrieStats::_searchCalls, &TrieStats::_searchNanoseconds);)
+			const NodeType * pTN	= _rootNode;
+			const CharType* buff = buffStart;
+
+			while (buff <= buffEnd)
+			{
+				pTN = FindChild(pTN, *buff);
+				if (NULL == pTN)
+				{
+					return;
+				}
+				TRIE_STATS_ONLY(scope.SetDepth(buff - buffStart + 1);)
+				if (pTN->IsEndOfWord() && (GetTags(pTN) & tags))
+				{
+					SearchResult<CharType> st(pTN,buff);
+					searchResults.push_back(st);
+					TRIE_STATS_ONLY(if (_stats) ++_stats->_matches;)
+
+					if (stopAtFirstMatch)
+					{
+						return;
+					}
+				}
+				buff++;
+			}
+		}
+
+		// Counting version of Search(). Rather than recording each match it
+		// increments the count for the matching word in histogram, so no
+		// results are stored. Returns the number of matches.
+		size_t Count(const CharType* buffStart,
+					 const CharType* buffEnd,
+					 KeywordHistogram& histogram,
+					 bool stopAtFirstMatch = false) const
+		{
+			TRIE_STATS_ONLY(TrieStatsScope scope(_stats, &TrieStats::_searchCalls, &TrieStats::_searchNanoseconds);)
+			if (histogram.GetSize() < _wordCount)
+			{
+				histogram.Resize(_wordCount);
+			}
+			const NodeType * pTN	= _rootNode;
+			const CharType* buff = buffStart;
+			size_t matches = 0;
+
+			while (buff <= buffEnd)
+			{
+				pTN = FindChild(pTN, *buff);
+				if (NULL == pTN)
+				{
+					break;
+				}
+				TRIE_STATS_ONLY(scope.SetDepth(buff - buffStart + 1);)
+				if (pTN->IsEndOfWord())
+				{
+					histogram.Add(pTN->GetWordId());
+					++matches;
+					TRIE_STATS_ONLY(if (_stats) ++_stats->_matches;)
+					if (stopAtFirstMatch)
+					{
+						break;
+					}
+				}
+				buff++;
+			}
+			return matches;
+		}
+
 		// Simply adds a word to the Trie. The return value should be stored as it will
-		// be required to identify the matching term.
+		// be required to identify the matching term. Once the trie holds
+		// MaxWords words new words are refused and NULL is returned.
 		const void* AddWord( const std::basic_string<CharType>& s )
 		{
 			if (!s.empty())
@@ -268,10 +1064,17 @@ class Trie
 
 		const void* AddWord( const CharType* p, const CharType* end )
 		{
-			TrieNode<CharType> * pTN = _rootNode;
+			TRIE_STATS_ONLY(TrieStatsScope scope(_stats, &TrieStats::_addWordCalls, &TrieStats::_addWordNanoseconds);)
+			TRIE_STATS_ONLY(scope.SetDepth(end - p + 1);)
+			if (_wordCount >= MaxWords)
+			{
+				// no ids left, only words already in the trie can be found
+				return Contains(p, end);
+			}
+			NodeType * pTN = _rootNode;
 			while (pTN && p <= end)
 			{
-				TrieNode<CharType>* pNext = pTN->FindNode(*p);
+				NodeType* pNext = FindChild(pTN, *p);
 
 				if (NULL == pNext)
 				{
@@ -286,17 +1089,150 @@ class Trie
 
 				++p;
 			}
-			// last node so set the word flag
-			pTN->SetEndOfWord();
+			// last node so set the word flag. New words are numbered
+			// in the order they are added.
+			if (!pTN->IsEndOfWord())
+			{
+				pTN->SetEndOfWord();
+				pTN->SetWordId(static_cast<unsigned int>(_wordCount++));
+			}
 
 			return pTN;
 		}
-		// this calls shrink_to_fit on each of the vectors
+		// this trims each of the child lists to size
 		// this call is recursive
 		void Compress()
 		{
 			_rootNode->Compress();
 		}
+		// Collect TRIE_STATS counters into stats, pass NULL to stop. Does
+		// nothing unless TRIE_STATS is defined. stats is not owned.
+		// The counters are plain, not atomic, and Search() updates them even
+		// though it is const, so only turn stats on for a trie that one
+		// thread is using, not one shared through a TrieHandle.
+		void SetStats( TrieStats* stats )
+		{
+			(void)stats;
+			TRIE_STATS_ONLY(_stats = stats;)
+		}
+		// Adds a word as a member of dictionary tag (0 to MaxTags-1). A word
+		// can carry several tags by adding it once per tag. Words added with
+		// plain AddWord() carry no tags and are never found by SearchTagged().
+		// Returns NULL, without adding the word, if tag is out of range.
+		const void* AddTaggedWord( const std::basic_string<CharType>& s, size_t tag )
+		{
+			if (!s.empty())
+			{
+				return AddTaggedWord(s.c_str(), &s[s.size()-1], tag);
+			}
+			return NULL;
+		}
+
+		const void* AddTaggedWord( const CharType* p, const CharType* end, size_t tag )
+		{
+			if (tag >= MaxTags)
+			{
+				return NULL;
+			}
+			const void* handle = AddWord(p, end);
+			if (handle)
+			{
+				_wordTags.resize(_wordCount, 0);
+				_wordTags[GetWordId(handle)] |= TagSet(1) << tag;
+			}
+			return handle;
+		}
+
+		// the tags carried by a word, as a bit mask
+		TagSet GetTags( const void* handle ) const
+		{
+			const size_t wordId = GetWordId(handle);
+			return wordId < _wordTags.size() ? _wordTags[wordId] : 0;
+		}
+
+		// number of distinct words added. Word ids run from 0 to GetWordCount()-1.
+		size_t GetWordCount() const
+		{
+			return _wordCount;
+		}
+		// converts a handle returned by AddWord() or held in a SearchResult
+		// into the word id
+		static size_t GetWordId( const void* handle )
+		{
+			return static_cast<const NodeType*>(handle)->GetWordId();
+		}
+		// root of the node graph. Used to walk the trie, for example
+		// when flattening it into a StaticTrie.
+		const NodeType* GetRootNode() const
+		{
+			return _rootNode;
+		}
+		// Relayout copies every node into one contiguous block in breadth
+		// first order, so a node's children sit next to each other and near
+		// the top of the trie. Each node's child list goes in the same
+		// block just ahead of the children, so a lookup reads the list and
+		// the child it finds together. Call it once the trie is fully populated,
+		// typically after Compress(). Words can still be added afterwards.
+		// Handles returned by AddWord() before the call are invalidated,
+		// use GetWordId() to identify words across a relayout.
+		void Relayout()
+		{
+			std::vector<const NodeType*> order;
+			std::vector<size_t> firstChild;
+			BreadthFirstOrder(order, firstChild);
+			std::vector<size_t> layout(order.size());
+			for (size_t i = 0; i < layout.size(); ++i)
+			{
+				layout[i] = i;
+			}
+			Relayout(order, firstChild, layout);
+		}
+
+		// As above but guided by a sample of typical input. The children of
+		// nodes reached while scanning the sample (every start position, as
+		// a full search would) are placed first, in breadth first order,
+		// followed by those of the nodes the sample never touched.
+		void Relayout( const CharType* sampleStart, const CharType* sampleEnd )
+		{
+			std::set<const NodeType*> hot;
+			hot.insert(_rootNode);
+			for (const CharType* start = sampleStart; start <= sampleEnd; ++start)
+			{
+				const NodeType* pTN = _rootNode;
+				for (const CharType* buff = start; buff <= sampleEnd; ++buff)
+				{
+					pTN = pTN->FindNode(*buff);
+					if (NULL == pTN)
+					{
+						break;
+					}
+					hot.insert(pTN);
+				}
+			}
+
+			std::vector<const NodeType*> order;
+			std::vector<size_t> firstChild;
+			BreadthFirstOrder(order, firstChild);
+			// the hot nodes then the rest, each in breadth first order
+			std::vector<size_t> layout;
+			layout.reserve(order.size());
+			for (size_t i = 0; i < order.size(); ++i)
+			{
+				if (hot.count(order[i]))
+				{
+					layout.push_back(i);
+				}
+			}
+			for (size_t i = 0; i < order.size(); ++i)
+			{
+				if (0 == hot.count(order[i]))
+				{
+					layout.push_back(i);
+				}
+			}
+			Relayout(order, firstChild, layout);
+		}
+
 		// invariant. check that trie is in a valid state
 		bool ValidateState() const
 		{
@@ -309,8 +1245,396 @@ class Trie
 			return _rootNode->ValidateState();
 		}
 		
+	private:
+		Trie(NodeType* rootNode, size_t wordCount) : _rootNode(rootNode), _wordCount(wordCount), _arena(NULL), _arenaSize(0) TRIE_STATS_ONLY(, _stats(NULL)) {}
+
+		// frees the node graph, including a relaid out arena
+		void DeleteNodes()
+		{
+			if (_arena)
+			{
+				_rootNode->DestroyArena(reinterpret_cast<NodeType*>(_arena), reinterpret_cast<NodeType*>(_arena + _arenaSize));
+				_rootNode->~NodeType();
+				::operator delete(_arena);
+				_arena = NULL;
+				_arenaSize = 0;
+			}
+			else
+			{
+				delete _rootNode;
+			}
+			_rootNode = NULL;
+		}
+
+		// Copies the nodes (order from BreadthFirstOrder()) into one
+		// allocation. The root goes first, then each node's child list
+		// followed by its children, so the list and the child a lookup
+		// finds in it are close together. The groups are in the order of
+		// their parents in layout, which must hold every node. Children
+		// are found by index, so nothing is allocated per node.
+		void Relayout( const std::vector<const NodeType*>& order,
+					   const std::vector<size_t>& firstChild,
+					   const std::vector<size_t>& layout )
+		{
+			const size_t nodeCount = order.size();
+			// offset of the group of each node with children
+			std::vector<size_t> group(nodeCount, 0);
+			size_t bytes = PackedAlign(sizeof(NodeType));
+			for (size_t i = 0; i < nodeCount; ++i)
+			{
+				const NodeType* pTN = order[layout[i]];
+				if (pTN->GetChildCount())
+				{
+					group[layout[i]] = bytes;
+					bytes += PackedAlign(pTN->GetPackedSize()) + PackedAlign(pTN->GetChildCount() * sizeof(NodeType));
+				}
+			}
+
+			char* arena = static_cast<char*>(::operator new(bytes));
+			std::vector<NodeType*> children;
+			CopyNode(order[0], arena, arena + group[0], children);
+			for (size_t i = 0; i < nodeCount; ++i)
+			{
+				NodeType* place = GroupNodes(order[i], arena + group[i]);
+				for (size_t c = 0; c < order[i]->GetChildCount(); ++c)
+				{
+					const size_t child = firstChild[i] + c;
+					CopyNode(order[child], place + c, arena + group[child], children);
+				}
+			}
+			DeleteNodes();
+			_rootNode = reinterpret_cast<NodeType*>(arena);
+			_arena = arena;
+			_arenaSize = bytes;
+		}
+
+		// the children in the group at list, after pTN's child list
+		static NodeType* GroupNodes( const NodeType* pTN, char* list )
+		{
+			return reinterpret_cast<NodeType*>(list + PackedAlign(pTN->GetPackedSize()));
+		}
+
+		// copies pTN into place with its children in the group at list
+		static void CopyNode( const NodeType* pTN, void* place, char* list, std::vector<NodeType*>& children )
+		{
+			NodeType* first = GroupNodes(pTN, list);
+			children.clear();
+			for (size_t c = 0; c < pTN->GetChildCount(); ++c)
+			{
+				children.push_back(first + c);
+			}
+			pTN->CopyTo(place, list, children.data());
+		}
+
+		// rounds bytes up so the child list after them is aligned
+		static size_t PackedAlign( size_t bytes )
+		{
+			const size_t alignment = alignof(unsigned long long) > alignof(void*) ? alignof(unsigned long long) : alignof(void*);
+			return (bytes + alignment - 1) / alignment * alignment;
+		}
+
+		// breadth first list of every node. The children of order[i] are
+		// order[firstChild[i]] onwards, in GetChild() order.
+		void BreadthFirstOrder( std::vector<const NodeType*>& order, std::vector<size_t>& firstChild ) const
+		{
+			order.clear();
+			firstChild.clear();
+			order.push_back(_rootNode);
+			for (size_t i = 0; i < order.size(); ++i)
+			{
+				firstChild.push_back(order.size());
+				for (size_t c = 0; c < order[i]->GetChildCount(); ++c)
+				{
+					order.push_back(order[i]->GetChild(c));
+				}
+			}
+		}
+
+		// number of lookups ContainsBatch() and LongestPrefixBatch() walk
+		// side by side
+		static const size_t BatchSize = 16;
+
+		// the guts of ContainsBatch() and LongestPrefixBatch(). Finds the
+		// longest prefix if positions is not NULL, else an exact match.
+		void FindBatch(const CharType* const* starts,
+					   const CharType* const* ends,
+					   size_t count,
+					   const void** results,
+					   const CharType** positions) const
+		{
+			for (size_t group = 0; group < count; group += BatchSize)
+			{
+				const size_t groupSize = (count - group < BatchSize) ? count - group : BatchSize;
+				const NodeType* nodes[BatchSize];
+				const CharType* buffs[BatchSize];
+				size_t active = 0;
+
+				for (size_t i = 0; i < groupSize; ++i)
+				{
+					results[group+i] = NULL;
+					if (positions)
+					{
+						positions[group+i] = NULL;
+					}
+					buffs[i] = starts[group+i];
+					nodes[i] = (buffs[i] <= ends[group+i]) ? _rootNode : NULL;
+					if (nodes[i])
+					{
+						++active;
+					}
+				}
+
+				while (active)
+				{
+					// nodes[i] was reached on the character before buffs[i]
+					// and prefetched in the last round. Check it, then start
+					// loading its child list...
+					for (size_t i = 0; i < groupSize; ++i)
+					{
+						if (NULL == nodes[i])
+						{
+							continue;
+						}
+						if (positions && buffs[i] > starts[group+i] && nodes[i]->IsEndOfWord())
+						{
+							results[group+i] = nodes[i];
+							positions[group+i] = buffs[i] - 1;
+						}
+						if (buffs[i] > ends[group+i])
+						{
+							if (NULL == positions && nodes[i]->IsEndOfWord())
+							{
+								results[group+i] = nodes[i];
+							}
+							nodes[i] = NULL;
+							--active;
+							continue;
+						}
+						nodes[i]->PrefetchChildren();
+					}
+					// ...then take one step down each walk and start loading
+					// the node it lands on, which is not touched until the
+					// next round
+					for (size_t i = 0; i < groupSize; ++i)
+					{
+						if (NULL == nodes[i])
+						{
+							continue;
+						}
+						nodes[i] = nodes[i]->FindNode(*buffs[i]);
+						if (NULL == nodes[i])
+						{
+							--active;
+							continue;
+						}
+						TRIE_PREFETCH(nodes[i]);
+						++buffs[i];
+					}
+				}
+			}
+		}
+
+		// FindNode() plus the TRIE_STATS accounting
+		template<typename Node>
+		Node* FindChild( Node* pTN, CharType c ) const
+		{
+#ifdef TRIE_STATS
+			if (_stats)
+			{
+				++_stats->_charactersExamined;
+				pTN = pTN->FindNode(c, _stats->_comparisons);
+				if (pTN)
+				{
+					++_stats->_nodeVisits;
+				}
+				return pTN;
+			}
+#endif
+			return pTN->FindNode(c);
+		}
+		template<typename> friend class TrieLoader;
+
+		// use Clone() to copy a trie
+		Trie& operator=(const Trie& rhs);
+		Trie(const Trie& rhs);
+
 	protected:
-		TrieNode<CharType>* _rootNode;
+		NodeType* _rootNode;
+		size_t _wordCount;
+		// single allocation holding the nodes and their child lists after
+		// Relayout(), or NULL, and its size in bytes
+		char* _arena;
+		size_t _arenaSize;
+		// tags of each word indexed by word id. Only as long as the highest
+		// tagged word id.
+		std::vector<TagSet> _wordTags;
+#ifdef TRIE_STATS
+		TrieStats* _stats;
+#endif
+};
+
+template<typename CharType, typename NodeType>
+void swap(Trie<CharType,NodeType>& lhs, Trie<CharType,NodeType>& rhs)
+{
+	lhs.swap(rhs);
+}
+
+// TrieScanner searches a whole buffer, as calling Trie::Search() at every
+// start position would, but in steps. Each Step() stops after a given
+// number of characters or matches and the next one carries on from the
+// same start position and trie node. Long documents can then be scanned
+// a slice at a time, in between other work on an event loop thread.
+// The trie and the buffer must outlive the scanner.
+template<typename CharType, typename NodeType = TrieNode<CharType> >
+class TrieScanner
+{
+	public:
+		TrieScanner( const Trie<CharType,NodeType>& trie,
+					 const CharType* buffStart,
+					 const CharType* buffEnd,
+					 bool stopAtFirstMatch = false )
+			: _rootNode(trie.GetRootNode()), _node(trie.GetRootNode()),
+			  _start(buffStart), _buff(buffStart), _buffEnd(buffEnd),
+			  _stopAtFirstMatch(stopAtFirstMatch)
+		{
+		}
+
+		// Scans until maxCharacters characters have been looked up or
+		// maxMatches results have been added to searchResults. Returns true
+		// if there is more to scan, false once the buffer is finished. A
+		// step that can not look up a single character, because a cap is 0,
+		// also returns false with IsDone() still false, so a loop on Step()
+		// can not spin.
+		bool Step( std::vector<SearchResult<CharType> >& searchResults,
+				   size_t maxCharacters,
+				   size_t maxMatches = static_cast<size_t>(-1) )
+		{
+			return Scan(searchResults, maxCharacters, maxMatches);
+		}
+
+		// As above but into a fixed size ring. With a StopWhenFull ring the
+		// step ends at the first match that does not fit, before looking it
+		// up, so no match is lost and the caller can drain the ring and call
+		// Step() again. If that is the very next match nothing was scanned
+		// and Step() returns false without IsDone(). An OverwriteOldest ring
+		// keeps the latest results and marks itself truncated.
+		bool Step( BoundedSearchResults<CharType>& searchResults,
+				   size_t maxCharacters,
+				   size_t maxMatches = static_cast<size_t>(-1) )
+		{
+			return Scan(searchResults, maxCharacters, maxMatches);
+		}
+
+		// true once the whole buffer has been scanned
+		bool IsDone() const { return _start > _buffEnd; }
+		// the start position currently being searched from
+		const CharType* GetPosition() const { return _start; }
+
+	private:
+		template<typename Results>
+		bool Scan( Results& searchResults, size_t maxCharacters, size_t maxMatches )
+		{
+			size_t characters = 0;
+			size_t matches = 0;
+
+			while (_start <= _buffEnd)
+			{
+				if (characters >= maxCharacters || matches >= maxMatches)
+				{
+					return characters > 0;
+				}
+				if (_buff > _buffEnd)
+				{
+					NextStart();
+					continue;
+				}
+				const NodeType* node = _node->FindNode(*_buff);
+				if (NULL == node)
+				{
+					++characters;
+					NextStart();
+					continue;
+				}
+				if (node->IsEndOfWord() && IsFull(searchResults))
+				{
+					// leave the match to be found again once there is room
+					return characters > 0;
+				}
+				_node = node;
+				++characters;
+				if (_node->IsEndOfWord())
+				{
+					Add(searchResults, SearchResult<CharType>(_node,_buff));
+					++matches;
+					if (_stopAtFirstMatch)
+					{
+						NextStart();
+						continue;
+					}
+				}
+				++_buff;
+			}
+			return false;
+		}
+
+		static bool IsFull( const std::vector<SearchResult<CharType> >& ) { return false; }
+		static bool IsFull( const BoundedSearchResults<CharType>& searchResults ) { return searchResults.IsFull(); }
+		static void Add( std::vector<SearchResult<CharType> >& searchResults, const SearchResult<CharType>& st )
+		{
+			searchResults.push_back(st);
+		}
+		static void Add( BoundedSearchResults<CharType>& searchResults, const SearchResult<CharType>& st )
+		{
+			searchResults.Add(st);
+		}
+
+		void NextStart()
+		{
+			++_start;
+			_buff = _start;
+			_node = _rootNode;
+		}
+
+		const NodeType* _rootNode;
+		const NodeType* _node;
+		const CharType* _start;
+		const CharType* _buff;
+		const CharType* _buffEnd;
+		bool _stopAtFirstMatch;
+};
+
+// TrieHandle publishes a trie to reader threads without a mutex. A writer
+// builds (or Clone()s and modifies) a new trie and calls Publish(). Readers
+// call Load() and hold on to the returned pointer while they search. The
+// old trie is freed once the last reader lets go of it.
+template<typename CharType, typename NodeType = TrieNode<CharType> >
+class TrieHandle
+{
+	public:
+		TrieHandle() {}
+		explicit TrieHandle( const std::shared_ptr<const Trie<CharType,NodeType> >& trie ) : _trie(trie) {}
+
+		std::shared_ptr<const Trie<CharType,NodeType> > Load() const
+		{
+			return std::atomic_load(&_trie);
+		}
+
+		void Publish( const std::shared_ptr<const Trie<CharType,NodeType> >& trie )
+		{
+			std::atomic_store(&_trie, trie);
+		}
+
+		// takes the contents of trie and publishes them
+		void Publish( Trie<CharType,NodeType>&& trie )
+		{
+			Publish(std::make_shared<const Trie<CharType,NodeType> >(std::move(trie)));
+		}
+
+	private:
+		TrieHandle& operator=(const TrieHandle& rhs);
+		TrieHandle(const TrieHandle& rhs);
+
+		std::shared_ptr<const Trie<CharType,NodeType> > _trie;
 };
 }
 #endif
@@ -0,0 +1,306 @@
+// This source was written by Stephen Oswin, and is placed in the
+// public domain. The author hereby disclaims copyright to this source
+// code.
+
+#ifndef __TRIELOADER_H
+#define __TRIELOADER_H
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Trie.h"
+
+namespace TDS
+{
+
+// Loads a newline delimited keyword file into a Trie<char>. A regular
+// file is memory mapped and the words are added straight from the mapping, so
+// there is no std::string per line. Words are split between threads by
+// their first character, each thread builds its own trie and the results
+// are attached under one root at the end.
+//
+// A line is either a keyword, or a keyword, a tab and a tag number (see
+// Trie::AddTaggedWord()). Empty lines and a trailing \r are ignored, and
+// so are lines with a tag of MaxTags or more, as AddTaggedWord() refuses
+// them. A tab with no tag after it is dropped and the keyword is added
+// untagged.
+// Word ids are numbered in file order, exactly as if the words had been
+// added one at a time with AddWord().
+//
+// Uses POSIX mmap(). Pipes and devices have no size to map and are read
+// into memory instead. Link with the platform thread library.
+template<typename NodeType = TrieNode<char> >
+class TrieLoader
+{
+	public:
+		typedef Trie<char,NodeType> TrieType;
+
+		// Replaces the contents of t with the words in path. threads of 0
+		// uses one thread per core. Returns false if the file can not be
+		// read or has more than TrieType::MaxWords different words, t is
+		// left unchanged.
+		static bool Load( const char* path, TrieType& t, unsigned int threads = 0 )
+		{
+			int fd = open(path, O_RDONLY);
+			if (fd < 0)
+			{
+				return false;
+			}
+			struct stat st;
+			if (fstat(fd, &st) != 0)
+			{
+				close(fd);
+				return false;
+			}
+			if (!S_ISREG(st.st_mode))
+			{
+				std::vector<char> contents;
+				const bool read = ReadAll(fd, contents);
+				close(fd);
+				return read && Load(contents.empty() ? NULL : &contents[0], contents.size(), t, threads);
+			}
+			const size_t size = static_cast<size_t>(st.st_size);
+			if (0 == size)
+			{
+				close(fd);
+				t = TrieType();
+				return true;
+			}
+			void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			close(fd);
+			if (MAP_FAILED == mapping)
+			{
+				return false;
+			}
+			madvise(mapping, size, MADV_SEQUENTIAL);
+			const bool loaded = Load(static_cast<const char*>(mapping), size, t, threads);
+			munmap(mapping, size);
+			return loaded;
+		}
+
+		// As above but from a buffer already in memory. Returns false if
+		// there are too many words.
+		static bool Load( const char* buff, size_t size, TrieType& t, unsigned int threads = 0 )
+		{
+			std::vector<Line> lines;
+			Parse(buff, size, lines);
+
+			if (0 == threads)
+			{
+				threads = std::max(1u, std::thread::hardware_concurrency());
+			}
+
+			// stable counting sort of the lines by first character, so each
+			// thread gets a contiguous run of lines that is still in file order
+			size_t bucketStart[257] = { 0 };
+			for (size_t i = 0; i < lines.size(); ++i)
+			{
+				++bucketStart[static_cast<unsigned char>(*lines[i]._begin) + 1];
+			}
+			for (size_t b = 1; b < 257; ++b)
+			{
+				bucketStart[b] += bucketStart[b-1];
+			}
+			std::vector<size_t> order(lines.size());
+			{
+				size_t next[256];
+				std::copy(bucketStart, bucketStart + 256, next);
+				for (size_t i = 0; i < lines.size(); ++i)
+				{
+					order[next[static_cast<unsigned char>(*lines[i]._begin)]++] = i;
+				}
+			}
+
+			// split the buckets into one contiguous range per thread,
+			// roughly the same number of lines each
+			std::vector<size_t> ranges(1, 0);
+			for (size_t b = 1; b < 256 && ranges.size() < threads; ++b)
+			{
+				// start the next range at bucket b once the current one
+				// has its share of the lines
+				if (bucketStart[b] >= lines.size() * ranges.size() / threads &&
+					bucketStart[b] > ranges.back())
+				{
+					ranges.push_back(bucketStart[b]);
+				}
+			}
+			ranges.push_back(lines.size());
+
+			std::vector<TrieType> parts(ranges.size() - 1);
+			std::vector<std::thread> workers;
+			for (size_t p = 1; p < parts.size(); ++p)
+			{
+				workers.push_back(std::thread(Build, std::ref(parts[p]), std::ref(lines), std::cref(order), ranges[p], ranges[p+1]));
+			}
+			Build(parts[0], lines, order, ranges[0], ranges[1]);
+			for (size_t w = 0; w < workers.size(); ++w)
+			{
+				workers[w].join();
+			}
+
+			// word ids are limited to MaxWords. A part that ran out refused
+			// its remaining new words and left them without a handle.
+			size_t wordCount = 0;
+			for (size_t p = 0; p < parts.size(); ++p)
+			{
+				wordCount += parts[p].GetWordCount();
+			}
+			for (size_t i = 0; i < lines.size() && wordCount <= TrieType::MaxWords; ++i)
+			{
+				if (NULL == lines[i]._handle)
+				{
+					wordCount = TrieType::MaxWords + 1;
+				}
+			}
+			if (wordCount > TrieType::MaxWords)
+			{
+				return false;
+			}
+
+			// the parts start with different characters so their first level
+			// nodes can simply be moved under one root
+			TrieType result;
+			for (size_t p = 0; p < parts.size(); ++p)
+			{
+				NodeType* root = parts[p]._rootNode;
+				for (size_t c = 0; c < root->GetChildCount(); ++c)
+				{
+					result._rootNode->AttachNode(const_cast<NodeType*>(root->GetChild(c)));
+				}
+				root->DetachChildren();
+			}
+
+			// number the words in file order
+			for (size_t i = 0; i < lines.size(); ++i)
+			{
+				if (lines[i]._firstOccurrence)
+				{
+					const_cast<NodeType*>(static_cast<const NodeType*>(lines[i]._handle))->SetWordId(static_cast<unsigned int>(result._wordCount++));
+				}
+				if (NoTag != lines[i]._tag)
+				{
+					result._wordTags.resize(result._wordCount, 0);
+					result._wordTags[TrieType::GetWordId(lines[i]._handle)] |= TagSet(1) << lines[i]._tag;
+				}
+			}
+			t = std::move(result);
+			return true;
+		}
+
+	private:
+		// Line::_tag of a line without a tag
+		static const size_t NoTag = static_cast<size_t>(-1);
+
+		struct Line
+		{
+			const char* _begin;
+			const char* _end;
+			size_t _tag;
+			// filled in by Build()
+			const void* _handle;
+			bool _firstOccurrence;
+		};
+
+		// reads fd to the end into contents
+		static bool ReadAll( int fd, std::vector<char>& contents )
+		{
+			char block[65536];
+			for (;;)
+			{
+				const ssize_t count = read(fd, block, sizeof(block));
+				if (count > 0)
+				{
+					contents.insert(contents.end(), block, block + count);
+				}
+				else if (0 == count)
+				{
+					return true;
+				}
+				else if (EINTR != errno)
+				{
+					return false;
+				}
+			}
+		}
+
+		// finds the words in buff
+		static void Parse( const char* buff, size_t size, std::vector<Line>& lines )
+		{
+			const char* end = buff + size;
+			while (buff < end)
+			{
+				const char* eol = static_cast<const char*>(memchr(buff, '\n', end - buff));
+				if (NULL == eol)
+				{
+					eol = end;
+				}
+				Line line;
+				line._begin = buff;
+				line._end = eol;
+				line._tag = NoTag;
+				line._handle = NULL;
+				line._firstOccurrence = false;
+				if (line._end > line._begin && '\r' == line._end[-1])
+				{
+					--line._end;
+				}
+				// optional tab and tag number
+				const char* tab = std::find(line._begin, line._end, '\t');
+				if (tab + 1 == line._end)
+				{
+					line._end = tab;
+				}
+				else if (tab + 1 < line._end)
+				{
+					size_t tag = 0;
+					const char* p = tab + 1;
+					for (; p < line._end && *p >= '0' && *p <= '9'; ++p)
+					{
+						// stop counting once out of range so it can not wrap
+						if (tag < TrieType::MaxTags)
+						{
+							tag = tag * 10 + (*p - '0');
+						}
+					}
+					if (p == line._end)
+					{
+						line._tag = tag;
+						line._end = tab;
+					}
+				}
+				if (line._end > line._begin && (NoTag == line._tag || line._tag < TrieType::MaxTags))
+				{
+					lines.push_back(line);
+				}
+				if (eol == end)
+				{
+					break;
+				}
+				buff = eol + 1;
+			}
+		}
+
+		// adds lines order[first] to order[last-1] to t
+		static void Build( TrieType& t, std::vector<Line>& lines, const std::vector<size_t>& order, size_t first, size_t last )
+		{
+			for (size_t i = first; i < last; ++i)
+			{
+				// each line is only written by the thread that owns it
+				Line& line = lines[order[i]];
+				const size_t wordCount = t.GetWordCount();
+				line._handle = t.AddWord(line._begin, line._end - 1);
+				line._firstOccurrence = t.GetWordCount() > wordCount;
+			}
+		}
+};
+
+}
+#endif
@@ -0,0 +1,224 @@
+// This source was written by Stephen Oswin, and is placed in the
+// public domain. The author hereby disclaims copyright to this source
+// code.
+
+// Compares the node types side by side: bytes per node and the time to
+// build a dictionary and to scan text with it. Usage:
+//   trie_bench [number of words] [text length]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "Trie.h"
+#include "BitmapTrieNode.h"
+#include "SortedArrayTrieNode.h"
+#include "DenseTrieNode.h"
+#include "CompactTrie.h"
+
+using namespace TDS;
+
+// Every allocation is prefixed with its size so the live heap can be
+// tracked. Counts the memory used by the node graph.
+static size_t liveBytes = 0;
+
+void* operator new( size_t size )
+{
+	size_t* p = static_cast<size_t*>(malloc(size + sizeof(size_t) * 2));
+	if (NULL == p)
+	{
+		throw std::bad_alloc();
+	}
+	*p = size;
+	liveBytes += size;
+	return p + 2;
+}
+
+void operator delete( void* ptr ) noexcept
+{
+	if (ptr)
+	{
+		size_t* p = static_cast<size_t*>(ptr) - 2;
+		liveBytes -= *p;
+		free(p);
+	}
+}
+
+typedef std::chrono::steady_clock Clock;
+
+double Milliseconds( Clock::time_point start )
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+template<typename NodeType>
+size_t CountNodes( const NodeType* pTN )
+{
+	size_t count = 1;
+	for (size_t i = 0; i < pTN->GetChildCount(); ++i)
+	{
+		count += CountNodes(pTN->GetChild(i));
+	}
+	return count;
+}
+
+// plain one at a time exact lookup, to compare with ContainsBatch()
+template<typename NodeType>
+const void* Lookup( const NodeType* pTN, const char* p, const char* end )
+{
+	for (; pTN && p <= end; ++p)
+	{
+		pTN = pTN->FindNode(*p);
+	}
+	return (pTN && pTN->IsEndOfWord()) ? pTN : NULL;
+}
+
+// time to Count() from every position of text, in ms
+template<typename NodeType>
+double Scan( const Trie<char,NodeType>& t, const std::string& text, size_t& matches )
+{
+	KeywordHistogram histogram(t.GetWordCount());
+	matches = 0;
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		matches += t.Count(&text[i], &text[text.size()-1], histogram);
+	}
+	return Milliseconds(start);
+}
+
+// time to look up every query one at a time, in ms
+template<typename NodeType>
+double Lookups( const Trie<char,NodeType>& t, const std::vector<const char*>& starts, const std::vector<const char*>& ends,
+				std::vector<const void*>& results )
+{
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < starts.size(); ++i)
+	{
+		results[i] = Lookup(t.GetRootNode(), starts[i], ends[i]);
+	}
+	return Milliseconds(start);
+}
+
+template<typename NodeType>
+void Benchmark( const char* name, const std::vector<std::string>& words, const std::string& text )
+{
+	const size_t before = liveBytes;
+	Clock::time_point start = Clock::now();
+	Trie<char,NodeType>* t = new Trie<char,NodeType>;
+	for (size_t i = 0; i < words.size(); ++i)
+	{
+		t->AddWord(words[i]);
+	}
+	t->Compress();
+	const double buildTime = Milliseconds(start);
+	const size_t bytes = liveBytes - before - sizeof(Trie<char,NodeType>);
+	const size_t nodes = CountNodes(t->GetRootNode());
+
+	size_t matches = 0;
+	const double searchTime = Scan(*t, text, matches);
+
+	printf("%-20s %10zu nodes %8.1f bytes/node %10.1f ms build %10.1f ms search %8.1f ns/char %zu matches\n",
+		   name, nodes, double(bytes) / nodes, buildTime, searchTime, searchTime * 1e6 / text.size(), matches);
+
+	// exact lookups of every word in a shuffled order, one at a time then batched
+	std::vector<const char*> starts;
+	std::vector<const char*> ends;
+	for (size_t i = 0; i < words.size(); ++i)
+	{
+		const std::string& word = words[(i * 7919) % words.size()];
+		starts.push_back(word.c_str());
+		ends.push_back(word.c_str() + word.size() - 1);
+	}
+	std::vector<const void*> results(words.size());
+	const double lookupTime = Lookups(*t, starts, ends, results);
+	start = Clock::now();
+	t->ContainsBatch(&starts[0], &ends[0], words.size(), &results[0]);
+	const double batchTime = Milliseconds(start);
+
+	printf("%-20s %10.1f ns/lookup %8.1f ns/lookup batched\n",
+		   name, lookupTime * 1e6 / words.size(), batchTime * 1e6 / words.size());
+
+	// the same again once the nodes and child lists are in one block
+	const size_t beforeRelayout = liveBytes;
+	start = Clock::now();
+	t->Relayout();
+	const double relayoutTime = Milliseconds(start);
+	const size_t relaidBytes = bytes + liveBytes - beforeRelayout;
+	const double relaidSearchTime = Scan(*t, text, matches);
+	const double relaidLookupTime = Lookups(*t, starts, ends, results);
+
+	printf("%-20s %10.1f ms relayout %8.1f bytes/node %8.1f ns/char %8.1f ns/lookup after Relayout()\n",
+		   name, relayoutTime, double(relaidBytes) / nodes, relaidSearchTime * 1e6 / text.size(),
+		   relaidLookupTime * 1e6 / words.size());
+	delete t;
+}
+
+// a CompactTrie frozen from a Trie<char>
+void BenchmarkCompact( const std::vector<std::string>& words, const std::string& text )
+{
+	Trie<char>* t = new Trie<char>;
+	for (size_t i = 0; i < words.size(); ++i)
+	{
+		t->AddWord(words[i]);
+	}
+	const size_t before = liveBytes;
+	Clock::time_point start = Clock::now();
+	CompactTrie<char>* ct = new CompactTrie<char>(*t);
+	const double buildTime = Milliseconds(start);
+	const size_t bytes = liveBytes - before - sizeof(CompactTrie<char>);
+	const size_t nodes = ct->GetNodeCount();
+	delete t;
+
+	std::vector<SearchResult<char> > searchResults;
+	size_t matches = 0;
+	start = Clock::now();
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		searchResults.clear();
+		ct->Search(&text[i], &text[text.size()-1], searchResults);
+		matches += searchResults.size();
+	}
+	const double searchTime = Milliseconds(start);
+
+	printf("%-20s %10zu nodes %8.1f bytes/node %10.1f ms freeze %9.1f ms search %8.1f ns/char %zu matches\n",
+		   "CompactTrie", nodes, double(bytes) / nodes, buildTime, searchTime, searchTime * 1e6 / text.size(), matches);
+	delete ct;
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t numberOfWords = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+	const size_t textLength = argc > 2 ? strtoul(argv[2], NULL, 10) : 2000000;
+
+	std::default_random_engine generator;
+	std::uniform_int_distribution<int> dRandLetter('a','z');
+	std::uniform_int_distribution<size_t> dRandSize(3,12);
+
+	std::vector<std::string> words;
+	for (size_t w = 0; w < numberOfWords; ++w)
+	{
+		std::string word;
+		for (size_t size = dRandSize(generator); size; --size)
+		{
+			word.append(1, static_cast<char>(dRandLetter(generator)));
+		}
+		words.push_back(word);
+	}
+	std::string text;
+	while (text.size() < textLength)
+	{
+		text.append(words[generator() % words.size()]);
+		text.append(1, ' ');
+		text.append(1, static_cast<char>(dRandLetter(generator)));
+	}
+
+	Benchmark<TrieNode<char> >("TrieNode", words, text);
+	Benchmark<BitmapTrieNode>("BitmapTrieNode", words, text);
+	Benchmark<SortedArrayTrieNode<char> >("SortedArrayTrieNode", words, text);
+	Benchmark<DenseTrieNode<char> >("DenseTrieNode", words, text);
+	BenchmarkCompact(words, text);
+	return 0;
+}
@@ -0,0 +1,657 @@
+// This source was written by Stephen Oswin, and is placed in the
+// public domain. The author hereby disclaims copyright to this source
+// code.
+
+// Differential tester. Every search mode and node type is run over the
+// same dictionary and text and compared with a brute force reference.
+// The first divergence is printed and the program aborts.
+//
+// Built normally it generates random dictionaries and texts:
+//   trie_fuzz [iterations] [seed]
+// Built with TRIE_LIBFUZZER defined (cmake -DTRIE_LIBFUZZER=ON, clang) it
+// is a libFuzzer target instead: the first input byte gives the number of
+// words, each word is a length byte followed by its bytes, and the rest of
+// the input is the text.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+
+#include "Trie.h"
+#include "StaticTrie.h"
+#include "BitmapTrieNode.h"
+#include "SortedArrayTrieNode.h"
+#include "DenseTrieNode.h"
+#include "CompactTrie.h"
+#include "TrieLoader.h"
+
+using namespace TDS;
+
+// (word id, offset of last character) of each match, ordered by start
+// position then length, the order Search() reports them in
+typedef std::vector<std::pair<size_t,size_t> > Matches;
+
+// what is being tested, printed when something diverges
+static std::string context;
+// which random case, printed when something diverges
+static std::string caseName;
+
+template<typename CharType>
+struct Dictionary
+{
+	Dictionary() : _maxLength(0) {}
+
+	// adds a word, ignoring empty words and duplicates. Ids are given in
+	// the order the words are first added, as Trie does.
+	void Add( const std::basic_string<CharType>& word )
+	{
+		if (!word.empty() && _ids.find(word) == _ids.end())
+		{
+			_ids[word] = _words.size();
+			_words.push_back(word);
+			_maxLength = std::max(_maxLength, word.size());
+		}
+	}
+
+	// id of word, or NotFound
+	size_t Find( const std::basic_string<CharType>& word ) const
+	{
+		typename std::map<std::basic_string<CharType>,size_t>::const_iterator i = _ids.find(word);
+		return i == _ids.end() ? NotFound : i->second;
+	}
+
+	static const size_t NotFound = static_cast<size_t>(-1);
+
+	std::vector<std::basic_string<CharType> > _words;
+	std::map<std::basic_string<CharType>,size_t> _ids;
+	size_t _maxLength;
+};
+
+// tag given to word id, so tagged searches have something to filter
+size_t TagOf( size_t wordId )
+{
+	return wordId % 3;
+}
+
+template<typename CharType>
+std::string Describe( const std::basic_string<CharType>& s )
+{
+	std::ostringstream os;
+	for (size_t i = 0; i < s.size(); ++i)
+	{
+		const unsigned long c = static_cast<unsigned long>(s[i]) & (sizeof(CharType) == 1 ? 0xff : 0xffffffff);
+		if (c >= 0x20 && c < 0x7f && c != '\\')
+		{
+			os << static_cast<char>(c);
+		}
+		else
+		{
+			os << "\\x" << std::hex << c << std::dec << ";";
+		}
+	}
+	return os.str();
+}
+
+template<typename CharType>
+void Diverged( const Dictionary<CharType>& d, const std::basic_string<CharType>& text, const std::string& message )
+{
+	printf("DIVERGENCE in %s %s\n%s\n", context.c_str(), caseName.c_str(), message.c_str());
+	printf("text \"%s\"\n", Describe(text).c_str());
+	for (size_t i = 0; i < d._words.size() && i < 50; ++i)
+	{
+		printf("word %zu \"%s\"\n", i, Describe(d._words[i]).c_str());
+	}
+	if (d._words.size() > 50)
+	{
+		printf("... %zu words\n", d._words.size());
+	}
+	fflush(stdout);
+	abort();
+}
+
+template<typename CharType>
+void Compare( const char* engine, const Matches& expected, const Matches& got,
+			  const Dictionary<CharType>& d, const std::basic_string<CharType>& text )
+{
+	for (size_t i = 0; i < std::max(expected.size(), got.size()); ++i)
+	{
+		if (i >= expected.size() || i >= got.size() || expected[i] != got[i])
+		{
+			std::ostringstream os;
+			os << engine << ": result " << i << " of " << expected.size() << " expected ";
+			if (i < expected.size())
+			{
+				os << "word " << expected[i].first << " ending at " << expected[i].second;
+			}
+			else
+			{
+				os << "nothing";
+			}
+			os << ", got ";
+			if (i < got.size())
+			{
+				os << "word " << got[i].first << " ending at " << got[i].second;
+			}
+			else
+			{
+				os << "nothing";
+			}
+			Diverged(d, text, os.str());
+		}
+	}
+}
+
+template<typename CharType>
+void Expect( bool ok, const char* engine, const std::string& what,
+			 const Dictionary<CharType>& d, const std::basic_string<CharType>& text )
+{
+	if (!ok)
+	{
+		Diverged(d, text, std::string(engine) + ": " + what);
+	}
+}
+
+// brute force: look up every substring up to the longest word
+template<typename CharType>
+void Reference( const Dictionary<CharType>& d, const std::basic_string<CharType>& text, bool stopAtFirstMatch, Matches& matches )
+{
+	matches.clear();
+	for (size_t start = 0; start < text.size(); ++start)
+	{
+		for (size_t length = 1; length <= d._maxLength && start + length <= text.size(); ++length)
+		{
+			const size_t id = d.Find(text.substr(start, length));
+			if (id != Dictionary<CharType>::NotFound)
+			{
+				matches.push_back(std::make_pair(id, start + length - 1));
+				if (stopAtFirstMatch)
+				{
+					break;
+				}
+			}
+		}
+	}
+}
+
+template<typename CharType, typename NodeType>
+void ToMatches( const std::vector<SearchResult<CharType> >& searchResults, const std::basic_string<CharType>& text, Matches& matches )
+{
+	matches.clear();
+	for (size_t i = 0; i < searchResults.size(); ++i)
+	{
+		matches.push_back(std::make_pair(static_cast<size_t>(Trie<CharType,NodeType>::GetWordId(searchResults[i].GetResult())),
+										 static_cast<size_t>(searchResults[i].GetPosition() - &text[0])));
+	}
+}
+
+template<typename CharType, typename NodeType>
+void SearchAll( const Trie<CharType,NodeType>& t, const std::basic_string<CharType>& text, bool stopAtFirstMatch, Matches& matches )
+{
+	std::vector<SearchResult<CharType> > searchResults;
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		t.Search(&text[i], &text[text.size()-1], searchResults, stopAtFirstMatch);
+	}
+	ToMatches<CharType,NodeType>(searchResults, text, matches);
+}
+
+template<typename CharType, typename NodeType>
+void ScanAll( const Trie<CharType,NodeType>& t, const std::basic_string<CharType>& text, bool stopAtFirstMatch,
+			  size_t maxCharacters, size_t maxMatches, Matches& matches )
+{
+	std::vector<SearchResult<CharType> > searchResults;
+	if (!text.empty())
+	{
+		TrieScanner<CharType,NodeType> scanner(t, &text[0], &text[text.size()-1], stopAtFirstMatch);
+		while (scanner.Step(searchResults, maxCharacters, maxMatches))
+		{
+		}
+	}
+	ToMatches<CharType,NodeType>(searchResults, text, matches);
+}
+
+// streams the results through a small ring, draining it after each step
+template<typename CharType, typename NodeType>
+void StreamAll( const Trie<CharType,NodeType>& t, const std::basic_string<CharType>& text, bool stopAtFirstMatch,
+				size_t capacity, Matches& matches )
+{
+	std::vector<SearchResult<CharType> > storage(capacity);
+	BoundedSearchResults<CharType> ring(&storage[0], capacity);
+	std::vector<SearchResult<CharType> > searchResults;
+	if (!text.empty())
+	{
+		TrieScanner<CharType,NodeType> scanner(t, &text[0], &text[text.size()-1], stopAtFirstMatch);
+		bool more = true;
+		while (more)
+		{
+			more = scanner.Step(ring, static_cast<size_t>(-1));
+			for (; ring.GetSize(); ring.PopFront())
+			{
+				searchResults.push_back(ring[0]);
+			}
+		}
+	}
+	ToMatches<CharType,NodeType>(searchResults, text, matches);
+}
+
+// the bounded Search() at every start position into an overwriting ring,
+// which should be left holding the last capacity results
+template<typename CharType, typename NodeType>
+void LastResults( const Trie<CharType,NodeType>& t, const std::basic_string<CharType>& text, bool stopAtFirstMatch,
+				  size_t capacity, Matches& matches, size_t& dropped )
+{
+	std::vector<SearchResult<CharType> > storage(capacity);
+	BoundedSearchResults<CharType> ring(&storage[0], capacity, BoundedSearchResults<CharType>::OverwriteOldest);
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		t.Search(&text[i], &text[text.size()-1], ring, stopAtFirstMatch);
+	}
+	std::vector<SearchResult<CharType> > searchResults;
+	for (size_t i = 0; i < ring.GetSize(); ++i)
+	{
+		searchResults.push_back(ring[i]);
+	}
+	dropped = ring.GetDropped();
+	ToMatches<CharType,NodeType>(searchResults, text, matches);
+}
+
+// the checks every trie goes through, whatever its node type
+template<typename CharType, typename NodeType>
+void CheckTrie( const char* engine, const Trie<CharType,NodeType>& t,
+				const Dictionary<CharType>& d, const std::basic_string<CharType>& text )
+{
+	Matches expected;
+	Matches got;
+
+	Expect(t.ValidateState(), engine, "ValidateState() failed", d, text);
+	Expect(t.GetWordCount() == d._words.size(), engine, "GetWordCount() wrong", d, text);
+
+	for (int stop = 0; stop < 2; ++stop)
+	{
+		Reference(d, text, stop != 0, expected);
+		SearchAll(t, text, stop != 0, got);
+		Compare(engine, expected, got, d, text);
+
+		ScanAll(t, text, stop != 0, 1 + text.size() % 7, 1 + text.size() % 3, got);
+		Compare(engine, expected, got, d, text);
+
+		StreamAll(t, text, stop != 0, 1 + text.size() % 5, got);
+		Compare(engine, expected, got, d, text);
+
+		const size_t capacity = 1 + text.size() % 4;
+		size_t dropped = 0;
+		LastResults(t, text, stop != 0, capacity, got, dropped);
+		Expect(dropped == expected.size() - got.size(), engine, "bounded Search() dropped count wrong", d, text);
+		expected.erase(expected.begin(), expected.end() - got.size());
+		Compare(engine, expected, got, d, text);
+	}
+
+	// counting
+	Reference(d, text, false, expected);
+	KeywordHistogram histogram(t.GetWordCount());
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		t.Count(&text[i], &text[text.size()-1], histogram);
+	}
+	std::vector<size_t> counts(d._words.size(), 0);
+	for (size_t i = 0; i < expected.size(); ++i)
+	{
+		++counts[expected[i].first];
+	}
+	for (size_t i = 0; i < counts.size(); ++i)
+	{
+		Expect(histogram.GetCount(i) == counts[i], engine, "Count() wrong", d, text);
+	}
+
+	// tagged search for tag 1
+	Matches tagged;
+	for (size_t i = 0; i < expected.size(); ++i)
+	{
+		if (TagOf(expected[i].first) == 1)
+		{
+			tagged.push_back(expected[i]);
+		}
+	}
+	std::vector<SearchResult<CharType> > searchResults;
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		t.SearchTagged(&text[i], &text[text.size()-1], searchResults, TagSet(1) << 1);
+	}
+	ToMatches<CharType,NodeType>(searchResults, text, got);
+	Compare(engine, tagged, got, d, text);
+
+	// exact and longest prefix lookups of every suffix of the text, and
+	// the word ending where the longest prefix does
+	std::vector<const CharType*> starts;
+	std::vector<const CharType*> ends;
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		starts.push_back(&text[i]);
+		ends.push_back(&text[text.size()-1]);
+	}
+	std::vector<const void*> results(text.size());
+	std::vector<const void*> exact(text.size());
+	std::vector<const CharType*> positions(text.size());
+	if (!text.empty())
+	{
+		t.LongestPrefixBatch(&starts[0], &ends[0], text.size(), &results[0], &positions[0]);
+		t.ContainsBatch(&starts[0], &ends[0], text.size(), &exact[0]);
+	}
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		size_t longest = Dictionary<CharType>::NotFound;
+		size_t longestLength = 0;
+		for (size_t length = 1; length <= d._maxLength && i + length <= text.size(); ++length)
+		{
+			const size_t id = d.Find(text.substr(i, length));
+			if (id != Dictionary<CharType>::NotFound)
+			{
+				longest = id;
+				longestLength = length;
+			}
+		}
+		const CharType* position = NULL;
+		const void* handle = t.LongestPrefix(starts[i], ends[i], &position);
+		if (longest == Dictionary<CharType>::NotFound)
+		{
+			Expect(NULL == handle && NULL == position, engine, "LongestPrefix() found a word", d, text);
+			Expect(NULL == results[i] && NULL == positions[i], engine, "LongestPrefixBatch() found a word", d, text);
+		}
+		else
+		{
+			Expect(handle && Trie<CharType,NodeType>::GetWordId(handle) == longest && position == &text[i + longestLength - 1],
+				   engine, "LongestPrefix() wrong", d, text);
+			Expect(results[i] == handle && positions[i] == position, engine, "LongestPrefixBatch() wrong", d, text);
+			Expect(t.Contains(starts[i], position) == handle, engine, "Contains() missed a word", d, text);
+		}
+		const size_t whole = d.Find(text.substr(i));
+		Expect((whole == Dictionary<CharType>::NotFound) == (NULL == exact[i]), engine, "ContainsBatch() wrong", d, text);
+		Expect(exact[i] == t.Contains(starts[i], ends[i]), engine, "ContainsBatch() and Contains() differ", d, text);
+	}
+	for (size_t i = 0; i < d._words.size(); ++i)
+	{
+		const void* handle = t.Contains(d._words[i]);
+		Expect(handle && Trie<CharType,NodeType>::GetWordId(handle) == i, engine, "Contains() missed a word", d, text);
+		Expect(t.GetTags(handle) == (TagSet(1) << TagOf(i)), engine, "GetTags() wrong", d, text);
+	}
+}
+
+// a CompactTrie made from t should find exactly what t does
+template<typename CharType, typename NodeType>
+void CheckCompactTrie( const Trie<CharType,NodeType>& t, const Dictionary<CharType>& d, const std::basic_string<CharType>& text )
+{
+	const char* engine = "CompactTrie";
+	const CompactTrie<CharType> ct(t);
+	Expect(ct.GetWordCount() == d._words.size(), engine, "GetWordCount() wrong", d, text);
+
+	Matches expected;
+	for (int stop = 0; stop < 2; ++stop)
+	{
+		Reference(d, text, stop != 0, expected);
+		std::vector<SearchResult<CharType> > searchResults;
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			ct.Search(&text[i], &text[text.size()-1], searchResults, stop != 0);
+		}
+		Matches got;
+		for (size_t i = 0; i < searchResults.size(); ++i)
+		{
+			got.push_back(std::make_pair(static_cast<size_t>(CompactTrie<CharType>::GetWordId(searchResults[i].GetResult())),
+										 static_cast<size_t>(searchResults[i].GetPosition() - &text[0])));
+		}
+		Compare(engine, expected, got, d, text);
+	}
+
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		const CharType* end = &text[text.size()-1];
+		const CharType* position = NULL;
+		const CharType* compactPosition = NULL;
+		const void* handle = t.LongestPrefix(&text[i], end, &position);
+		const void* compact = ct.LongestPrefix(&text[i], end, &compactPosition);
+		Expect((NULL == handle) == (NULL == compact) && position == compactPosition &&
+			   (NULL == handle || Trie<CharType,NodeType>::GetWordId(handle) == CompactTrie<CharType>::GetWordId(compact)),
+			   engine, "LongestPrefix() wrong", d, text);
+		handle = t.Contains(&text[i], end);
+		compact = ct.Contains(&text[i], end);
+		Expect((NULL == handle) == (NULL == compact), engine, "Contains() wrong", d, text);
+	}
+	for (size_t i = 0; i < d._words.size(); ++i)
+	{
+		const std::basic_string<CharType>& word = d._words[i];
+		const void* handle = ct.Contains(&word[0], &word[word.size()-1]);
+		Expect(handle && CompactTrie<CharType>::GetWordId(handle) == i, engine, "Contains() missed a word", d, text);
+	}
+}
+
+template<typename CharType, typename NodeType>
+void Build( Trie<CharType,NodeType>& t, const Dictionary<CharType>& d )
+{
+	for (size_t i = 0; i < d._words.size(); ++i)
+	{
+		t.AddTaggedWord(d._words[i], TagOf(i));
+	}
+}
+
+// every engine over one dictionary and text
+template<typename CharType, typename NodeType>
+void CheckNodeType( const char* name, const Dictionary<CharType>& d, const std::basic_string<CharType>& text )
+{
+	Trie<CharType,NodeType> t;
+	Build(t, d);
+	context = name;
+	CheckTrie("Trie", t, d, text);
+
+	t.Compress();
+	CheckTrie("Compress()", t, d, text);
+	CheckCompactTrie(t, d, text);
+
+	Trie<CharType,NodeType> clone = t.Clone();
+	CheckTrie("Clone()", clone, d, text);
+
+	t.Relayout();
+	CheckTrie("Relayout()", t, d, text);
+
+	if (!text.empty())
+	{
+		clone.Relayout(&text[0], &text[text.size()/2]);
+		CheckTrie("Relayout(sample)", clone, d, text);
+	}
+
+	Trie<CharType,NodeType> moved(std::move(clone));
+	CheckTrie("move", moved, d, text);
+}
+
+void CheckStaticTrie( const Dictionary<char>& d, const std::string& text )
+{
+	Trie<char> t;
+	Build(t, d);
+	std::vector<StaticTrieNode<char> > nodes;
+	std::map<const void*,unsigned int> handles;
+	FlattenTrie(t, nodes, &handles);
+	StaticTrie<char> st(&nodes[0], nodes.size());
+
+	// node index back to word id
+	std::map<size_t,size_t> ids;
+	for (std::map<const void*,unsigned int>::const_iterator i = handles.begin(); i != handles.end(); ++i)
+	{
+		ids[i->second] = Trie<char>::GetWordId(i->first);
+	}
+
+	context = "StaticTrie";
+	Matches expected;
+	for (int stop = 0; stop < 2; ++stop)
+	{
+		Reference(d, text, stop != 0, expected);
+		std::vector<SearchResult<char> > searchResults;
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			st.Search(&text[i], &text[text.size()-1], searchResults, stop != 0);
+		}
+		Matches got;
+		for (size_t i = 0; i < searchResults.size(); ++i)
+		{
+			got.push_back(std::make_pair(ids[st.GetNodeIndex(searchResults[i].GetResult())],
+										 static_cast<size_t>(searchResults[i].GetPosition() - &text[0])));
+		}
+		Compare("StaticTrie", expected, got, d, text);
+	}
+}
+
+template<typename NodeType>
+void CheckLoader( const char* name, const Dictionary<char>& d, const std::string& text )
+{
+	// the file format can not hold these characters in a word
+	std::string file;
+	for (size_t i = 0; i < d._words.size(); ++i)
+	{
+		if (d._words[i].find_first_of("\r\n\t") != std::string::npos)
+		{
+			return;
+		}
+		std::ostringstream os;
+		os << d._words[i] << "\t" << TagOf(i) << "\n";
+		file.append(os.str());
+	}
+	Trie<char,NodeType> t;
+	const bool loaded = TrieLoader<NodeType>::Load(file.c_str(), file.size(), t, 3);
+	context = name;
+	Expect(loaded, "TrieLoader", "Load() failed", d, text);
+	CheckTrie("TrieLoader", t, d, text);
+}
+
+void Check( const Dictionary<char>& d, const std::string& text )
+{
+	CheckNodeType<char,TrieNode<char> >("Trie<char>", d, text);
+	CheckNodeType<char,BitmapTrieNode>("Trie<char,BitmapTrieNode>", d, text);
+	CheckNodeType<char,SortedArrayTrieNode<char> >("Trie<char,SortedArrayTrieNode>", d, text);
+	CheckNodeType<char,DenseTrieNode<char> >("Trie<char,DenseTrieNode>", d, text);
+	CheckStaticTrie(d, text);
+	CheckLoader<TrieNode<char> >("TrieLoader<>", d, text);
+	CheckLoader<BitmapTrieNode>("TrieLoader<BitmapTrieNode>", d, text);
+	CheckLoader<SortedArrayTrieNode<char> >("TrieLoader<SortedArrayTrieNode>", d, text);
+	CheckLoader<DenseTrieNode<char> >("TrieLoader<DenseTrieNode>", d, text);
+}
+
+void Check( const Dictionary<wchar_t>& d, const std::wstring& text )
+{
+	CheckNodeType<wchar_t,TrieNode<wchar_t> >("Trie<wchar_t>", d, text);
+	CheckNodeType<wchar_t,SortedArrayTrieNode<wchar_t> >("Trie<wchar_t,SortedArrayTrieNode>", d, text);
+}
+
+#ifdef TRIE_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput( const uint8_t* data, size_t size )
+{
+	if (0 == size)
+	{
+		return 0;
+	}
+	Dictionary<char> d;
+	Dictionary<wchar_t> wd;
+	size_t pos = 1;
+	for (size_t words = data[0] % 32; words && pos < size; --words)
+	{
+		const size_t wanted = data[pos] % 16 + 1;
+		++pos;
+		const size_t length = std::min(wanted, size - pos);
+		const std::string word(reinterpret_cast<const char*>(data + pos), length);
+		d.Add(word);
+		// the same bytes spread over a wide alphabet
+		std::wstring wide;
+		for (size_t i = 0; i < word.size(); ++i)
+		{
+			wide.append(1, static_cast<wchar_t>(static_cast<unsigned char>(word[i]) * 251));
+		}
+		wd.Add(wide);
+		pos += length;
+	}
+	const std::string text(reinterpret_cast<const char*>(data + pos), size - pos);
+	std::wstring wtext;
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		wtext.append(1, static_cast<wchar_t>(static_cast<unsigned char>(text[i]) * 251));
+	}
+	Check(d, text);
+	Check(wd, wtext);
+	return 0;
+}
+
+#else
+
+// random word or text over an alphabet of alphabetSize characters
+// starting at first
+template<typename CharType>
+std::basic_string<CharType> RandomString( std::mt19937& generator, long first, long alphabetSize, size_t length )
+{
+	std::uniform_int_distribution<long> dRandChar(first, first + alphabetSize - 1);
+	std::basic_string<CharType> s;
+	for (size_t i = 0; i < length; ++i)
+	{
+		s.append(1, static_cast<CharType>(dRandChar(generator)));
+	}
+	return s;
+}
+
+template<typename CharType>
+void RandomCase( std::mt19937& generator, long first, long alphabetSize, size_t numberOfWords, size_t textLength )
+{
+	std::uniform_int_distribution<size_t> dRandLength(1, 1 + generator() % 12);
+	std::basic_string<CharType> text = RandomString<CharType>(generator, first, alphabetSize, textLength);
+	Dictionary<CharType> d;
+	for (size_t i = 0; i < numberOfWords; ++i)
+	{
+		const size_t length = dRandLength(generator);
+		// half the words are taken from the text so there are matches
+		if (i % 2 && text.size() >= length)
+		{
+			d.Add(text.substr(generator() % (text.size() - length + 1), length));
+		}
+		else
+		{
+			d.Add(RandomString<CharType>(generator, first, alphabetSize, length));
+		}
+	}
+	Check(d, text);
+}
+
+int main(int argc, char* argv[])
+{
+	const unsigned long iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000;
+	const unsigned long seed = argc > 2 ? strtoul(argv[2], NULL, 10) : 1;
+
+	const long alphabets[] = { 1, 2, 4, 26, 256 };
+	for (unsigned long i = 0; i < iterations; ++i)
+	{
+		std::mt19937 generator(seed + i);
+		std::ostringstream os;
+		os << "seed " << seed + i;
+		caseName = os.str();
+
+		const long alphabetSize = alphabets[generator() % 5];
+		// a huge dictionary every so often
+		const size_t numberOfWords = (i % 50 == 49) ? 20000 : generator() % 200;
+		const size_t textLength = generator() % 400;
+
+		// char alphabets anywhere in the byte range, including '\0' and
+		// negative chars
+		const long first = static_cast<long>(generator() % (257 - alphabetSize)) - 128;
+		RandomCase<char>(generator, first, alphabetSize, numberOfWords, textLength);
+
+		// wide alphabets, far apart
+		RandomCase<wchar_t>(generator, generator() % 0x10000, alphabetSize * 100, numberOfWords / 4, textLength / 4);
+
+		if ((i + 1) % 100 == 0)
+		{
+			printf("%lu iterations, no divergence\n", i + 1);
+		}
+	}
+	printf("passed %lu iterations from seed %lu\n", iterations, seed);
+	return 0;
+}
+
+#endif
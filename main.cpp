@@ -8,21 +8,54 @@
 #include <algorithm>
 #include <random>
 #include <set>
+#include <thread>
 #include <time.h>
+#include <sys/stat.h>
 
 #include "Trie.h"
+#include "StaticTrie.h"
+#include "BitmapTrieNode.h"
+#include "SortedArrayTrieNode.h"
+#include "DenseTrieNode.h"
+#include "CompactTrie.h"
+#include "TrieLoader.h"
+#include "TestKeywords.h"
 
 using namespace TDS;
 
-template <typename CharType>
-void AddWord( const std::basic_string<CharType>& s, Trie<CharType>& t, std::map<const void *,std::basic_string<CharType> >& d)
+template <typename CharType, typename NodeType>
+void AddWord( const std::basic_string<CharType>& s, Trie<CharType,NodeType>& t, std::map<const void *,std::basic_string<CharType> >& d)
 {
 	d[t.AddWord(s)]=s;
 }
 
+template <typename CharType, typename NodeType>
+void Search( const std::basic_string<CharType>& input, 
+			 const Trie<CharType,NodeType>& t,
+			 std::vector<SearchResult<CharType> >& searchResults,
+			 bool stopAtFirstMatch = false)
+{
+	for(size_t i = 0; i < input.size(); ++i)
+	{
+		t.Search(&input[i], &input[input.size()-1], searchResults, stopAtFirstMatch);
+	}
+}
+
+template <typename CharType>
+void Search( const std::basic_string<CharType>& input, 
+			 const StaticTrie<CharType>& t,
+			 std::vector<SearchResult<CharType> >& searchResults,
+			 bool stopAtFirstMatch = false)
+{
+	for(size_t i = 0; i < input.size(); ++i)
+	{
+		t.Search(&input[i], &input[input.size()-1], searchResults, stopAtFirstMatch);
+	}
+}
+
 template <typename CharType>
 void Search( const std::basic_string<CharType>& input, 
-			 const Trie<CharType>& t,
+			 const CompactTrie<CharType>& t,
 			 std::vector<SearchResult<CharType> >& searchResults,
 			 bool stopAtFirstMatch = false)
 {
@@ -576,7 +609,7 @@ void TestRandomWords(size_t numberOfWords, size_t minWordLength, size_t maxWordL
 
 	std::string infiniteMonkeys;
 	std::default_random_engine generator;
-	std::uniform_int_distribution<char> dRandLetter('a','z');
+	std::uniform_int_distribution<int> dRandLetter('a','z');
 	std::uniform_int_distribution<size_t> dRandSize(minWordLength,maxWordLength);
 	std::set<std::string> wordsAddedToDictionary;
 
@@ -585,7 +618,7 @@ void TestRandomWords(size_t numberOfWords, size_t minWordLength, size_t maxWordL
 		std::string randomWord;
 		for( size_t wordSize = 0; wordSize < dRandSize(generator); ++wordSize )
 		{
-			char c = dRandLetter(generator);
+			char c = static_cast<char>(dRandLetter(generator));
 			randomWord.append(1,c);
 		}
 		infiniteMonkeys.append(randomWord);
@@ -655,6 +688,1230 @@ void TestRandomWords(size_t numberOfWords, size_t minWordLength, size_t maxWordL
 	}
 }
 
+void TestStaticTrieGenerated()
+{
+	// TestKeywords is generated at build time from test_keywords.txt
+	std::vector<SearchResult<char> > searchResults;
+	std::string test("POST /form HTTP/1.1 then GET /index and a PATCH. GETS");
+	Search( test, TestKeywords, searchResults );
+	TEST(searchResults.size()==4);
+
+	// POST is the third word in the file, GET the first, PATCH the ninth
+	TEST(TestKeywords.GetNodeIndex(searchResults[0].GetResult())==TestKeywords_words[2]);
+	TEST(searchResults[0].GetPosition()==&test[3]);
+	TEST(TestKeywords.GetNodeIndex(searchResults[1].GetResult())==TestKeywords_words[0]);
+	TEST(searchResults[1].GetPosition()==&test[27]);
+	TEST(TestKeywords.GetNodeIndex(searchResults[2].GetResult())==TestKeywords_words[8]);
+	TEST(searchResults[2].GetPosition()==&test[46]);
+	TEST(TestKeywords.GetNodeIndex(searchResults[3].GetResult())==TestKeywords_words[0]);
+	TEST(searchResults[3].GetPosition()==&test[51]);
+}
+
+void TestStaticTrieMatchesTrie()
+{
+	Trie<char> t;
+	std::map<const void *,std::string> dictionary;
+	std::vector<SearchResult<char> > searchResults;
+	std::vector<SearchResult<char> > staticResults;
+
+	AddWord<char>("a", t, dictionary);
+	AddWord<char>("ab", t, dictionary);
+	AddWord<char>("abc", t, dictionary);
+	AddWord<char>("bc", t, dictionary);
+	AddWord<char>("cab", t, dictionary);
+
+	std::vector<StaticTrieNode<char> > nodes;
+	std::map<const void*,unsigned int> handles;
+	FlattenTrie(t, nodes, &handles);
+	StaticTrie<char> st(&nodes[0], nodes.size());
+	TEST(st.GetNodeCount()==nodes.size());
+	TEST(handles.size()==5);
+
+	std::string test("abcab cabc bca");
+	Search( test, t, searchResults );
+	Search( test, st, staticResults );
+	TEST(searchResults.size()==staticResults.size());
+	for (size_t i = 0; i < searchResults.size(); ++i)
+	{
+		TEST(handles[searchResults[i].GetResult()]==st.GetNodeIndex(staticResults[i].GetResult()));
+		TEST(searchResults[i].GetPosition()==staticResults[i].GetPosition());
+	}
+
+	searchResults.clear();
+	staticResults.clear();
+	Search( test, t, searchResults, true );
+	Search( test, st, staticResults, true );
+	TEST(searchResults.size()==staticResults.size());
+}
+
+void TestMoveAndSwap()
+{
+	Trie<char> t;
+	std::map<const void *,std::string> dictionary;
+	std::vector<SearchResult<char> > searchResults;
+
+	AddWord<char>("fox", t, dictionary);
+	AddWord<char>("dog", t, dictionary);
+	std::string test("the quick brown fox jumped over the lazy dog");
+
+	// move construction leaves t empty
+	Trie<char> moved(std::move(t));
+	Search( test, t, searchResults );
+	TEST(searchResults.size()==0);
+	TEST(t.ValidateState());
+	Search( test, moved, searchResults );
+	TEST(searchResults.size()==2);
+	TEST(dictionary[searchResults[0].GetResult()]=="fox");
+	TEST(dictionary[searchResults[1].GetResult()]=="dog");
+
+	// the moved from trie can still be used
+	AddWord<char>("lazy", t, dictionary);
+	searchResults.clear();
+	Search( test, t, searchResults );
+	TEST(searchResults.size()==1);
+	TEST(dictionary[searchResults[0].GetResult()]=="lazy");
+
+	swap(t, moved);
+	searchResults.clear();
+	Search( test, t, searchResults );
+	TEST(searchResults.size()==2);
+	searchResults.clear();
+	Search( test, moved, searchResults );
+	TEST(searchResults.size()==1);
+
+	// move assignment
+	moved = std::move(t);
+	searchResults.clear();
+	Search( test, moved, searchResults );
+	TEST(searchResults.size()==2);
+	TEST(moved.ValidateState());
+	TEST(t.ValidateState());
+}
+
+void TestClone()
+{
+	Trie<char> t;
+	std::map<const void *,std::string> dictionary;
+	std::vector<SearchResult<char> > searchResults;
+	std::vector<SearchResult<char> > cloneResults;
+
+	AddWord<char>("a", t, dictionary);
+	AddWord<char>("ab", t, dictionary);
+	AddWord<char>("abc", t, dictionary);
+	AddWord<char>("bat", t, dictionary);
+	t.Compress();
+
+	Trie<char> clone = t.Clone();
+	TEST(clone.ValidateState());
+
+	// changing the original must not change the clone
+	AddWord<char>("at", t, dictionary);
+
+	std::string test("abc bat");
+	Search( test, t, searchResults );
+	Search( test, clone, cloneResults );
+	TEST(searchResults.size()==6);
+	TEST(cloneResults.size()==5);
+	TEST(cloneResults[0].GetPosition()==&test[0]);
+	TEST(cloneResults[1].GetPosition()==&test[1]);
+	TEST(cloneResults[2].GetPosition()==&test[2]);
+	TEST(cloneResults[3].GetPosition()==&test[6]);
+	TEST(cloneResults[4].GetPosition()==&test[5]);
+	// clone has its own nodes, so different handles
+	TEST(dictionary.find(cloneResults[0].GetResult())==dictionary.end());
+}
+
+void TestTrieHandle()
+{
+	std::vector<SearchResult<char> > searchResults;
+	std::string test("the quick brown fox jumped over the lazy dog");
+
+	Trie<char> t;
+	const void * fox = t.AddWord("fox");
+	TrieHandle<char> handle;
+	TEST(!handle.Load());
+	handle.Publish(std::move(t));
+
+	// a reader holds on to the published trie
+	std::shared_ptr<const Trie<char> > reader = handle.Load();
+
+	Trie<char> rebuilt;
+	const void * dog = rebuilt.AddWord("dog");
+	handle.Publish(std::move(rebuilt));
+
+	Search( test, *reader, searchResults );
+	TEST(searchResults.size()==1);
+	TEST(searchResults[0].GetResult()==fox);
+
+	searchResults.clear();
+	Search( test, *handle.Load(), searchResults );
+	TEST(searchResults.size()==1);
+	TEST(searchResults[0].GetResult()==dog);
+}
+
+template <typename CharType>
+void Count( const std::basic_string<CharType>& input, 
+			const Trie<CharType>& t,
+			KeywordHistogram& histogram,
+			bool stopAtFirstMatch = false)
+{
+	for(size_t i = 0; i < input.size(); ++i)
+	{
+		t.Count(&input[i], &input[input.size()-1], histogram, stopAtFirstMatch);
+	}
+}
+
+void TestWordIds()
+{
+	Trie<char> t;
+	const void * a = t.AddWord("a");
+	const void * abc = t.AddWord("abc");
+	const void * ab = t.AddWord("ab");
+	TEST(t.GetWordCount()==3);
+	TEST(Trie<char>::GetWordId(a)==0);
+	TEST(Trie<char>::GetWordId(abc)==1);
+	TEST(Trie<char>::GetWordId(ab)==2);
+	// adding a word again keeps its id
+	TEST(t.AddWord("abc")==abc);
+	TEST(t.GetWordCount()==3);
+	TEST(Trie<char>::GetWordId(t.Clone().AddWord("ab"))==2);
+}
+
+void TestCount()
+{
+	Trie<char> t;
+	std::map<const void *,std::string> dictionary;
+	std::vector<SearchResult<char> > searchResults;
+
+	AddWord<char>("a", t, dictionary);
+	AddWord<char>("ab", t, dictionary);
+	AddWord<char>("abc", t, dictionary);
+	AddWord<char>("abcd", t, dictionary);
+	AddWord<char>("abcde", t, dictionary);
+	AddWord<char>("abcdef", t, dictionary);
+	AddWord<char>("abcdefg", t, dictionary);
+	AddWord<char>("zzz", t, dictionary);
+
+	std::string test("abc abcdefg a a a abcdef abcd abcd");
+	KeywordHistogram histogram(t.GetWordCount());
+	Count( test, t, histogram );
+	Search( test, t, searchResults );
+
+	// counts agree with Search()
+	TEST(histogram.GetSize()==8);
+	std::vector<size_t> expected(t.GetWordCount(), 0);
+	for (size_t i = 0; i < searchResults.size(); ++i)
+	{
+		++expected[Trie<char>::GetWordId(searchResults[i].GetResult())];
+	}
+	for (size_t i = 0; i < expected.size(); ++i)
+	{
+		TEST(histogram.GetCount(i)==expected[i]);
+	}
+	TEST(histogram.GetCount(0)==8);
+	TEST(histogram.GetCount(7)==0);
+
+	std::vector<std::pair<size_t,size_t> > topN;
+	histogram.TopN(3, topN);
+	TEST(topN.size()==3);
+	TEST(topN[0].first==0 && topN[0].second==8);
+	TEST(topN[1].first==1 && topN[1].second==5);
+	TEST(topN[2].first==2 && topN[2].second==5);
+	// words without matches are never reported
+	histogram.TopN(100, topN);
+	TEST(topN.size()==7);
+
+	// stopAtFirstMatch only counts "a"
+	KeywordHistogram first;
+	Count( test, t, first, true );
+	TEST(first.GetSize()==8);
+	TEST(first.GetCount(0)==8);
+	TEST(first.GetCount(1)==0);
+
+	// merging per thread histograms
+	histogram.Merge(first);
+	TEST(histogram.GetCount(0)==16);
+	TEST(histogram.GetCount(1)==5);
+	histogram.Clear();
+	TEST(histogram.GetCount(0)==0);
+}
+
+void TestStats()
+{
+#ifdef TRIE_STATS
+	Trie<char> t;
+	std::vector<SearchResult<char> > searchResults;
+	TrieStats stats;
+	t.SetStats(&stats);
+
+	t.AddWord("cat");
+	t.AddWord("car");
+	t.AddWord("cab");
+	TEST(stats._addWordCalls==3);
+	TEST(stats._charactersExamined==9);
+	// c, ca, c and ca are found, the rest are added
+	TEST(stats._nodeVisits==4);
+	TEST(stats._maxDepth==3);
+
+	stats.Clear();
+	std::string test("cart");
+	Search( test, t, searchResults );
+	TEST(stats._searchCalls==4);
+	// c a r then t fails, a fails, r fails, t fails
+	TEST(stats._charactersExamined==7);
+	TEST(stats._nodeVisits==3);
+	TEST(stats._matches==1);
+	TEST(stats._maxDepth==3);
+	TEST(stats._comparisons>0);
+
+	// Count() and SearchTagged() are searches too
+	stats.Clear();
+	KeywordHistogram histogram;
+	t.Count(&test[0], &test[test.size()-1], histogram);
+	TEST(stats._searchCalls==1);
+	TEST(stats._charactersExamined==4);
+	TEST(stats._matches==1);
+	stats.Clear();
+	t.AddTaggedWord("cart", 0);
+	TEST(stats._addWordCalls==1);
+	stats.Clear();
+	searchResults.clear();
+	t.SearchTagged(&test[0], &test[test.size()-1], searchResults, 1);
+	TEST(stats._searchCalls==1);
+	TEST(stats._nodeVisits==4);
+	TEST(stats._matches==1);
+	TEST(stats._maxDepth==4);
+
+	// no more counting once detached
+	t.SetStats(NULL);
+	Search( test, t, searchResults );
+	TEST(stats._searchCalls==1);
+#endif
+}
+
+// word id and position of every result, used to compare searches
+// across a Relayout() which changes the handles
+void ResultIds( const std::vector<SearchResult<char> >& searchResults,
+				std::vector<std::pair<size_t,const char*> >& ids )
+{
+	ids.clear();
+	for (size_t i = 0; i < searchResults.size(); ++i)
+	{
+		ids.push_back(std::make_pair(Trie<char>::GetWordId(searchResults[i].GetResult()), searchResults[i].GetPosition()));
+	}
+}
+
+void TestRelayout()
+{
+	Trie<char> t;
+	std::vector<SearchResult<char> > searchResults;
+	std::vector<std::pair<size_t,const char*> > before;
+	std::vector<std::pair<size_t,const char*> > after;
+
+	t.AddWord("cat");
+	t.AddWord("car");
+	t.AddWord("cab");
+	t.AddWord("a");
+	t.AddWord("at");
+	t.AddWord("zebra");
+	t.Compress();
+
+	std::string test("caz cat sat on the car. it was a cab. cat zebra");
+	Search( test, t, searchResults );
+	ResultIds(searchResults, before);
+
+	t.Relayout();
+	TEST(t.ValidateState());
+	// breadth first, so the root's children follow it, side by side
+	const TrieNode<char>* root = t.GetRootNode();
+	TEST(root->GetChild(0) > root);
+	TEST(root->GetChild(1)==root->GetChild(0)+1);
+	TEST(root->GetChild(2)==root->GetChild(0)+2);
+	TEST(root->GetChild(0)->GetChild(0) > root->GetChild(2));
+
+	searchResults.clear();
+	Search( test, t, searchResults );
+	ResultIds(searchResults, after);
+	TEST(before==after);
+
+	// words can still be added, and found
+	t.AddWord("cabbage");
+	t.AddWord("on");
+	TEST(t.GetWordCount()==8);
+	TEST(t.ValidateState());
+	searchResults.clear();
+	Search( test, t, searchResults );
+	TEST(searchResults.size()==before.size()+1);
+
+	// sample guided layout. Nodes for "zebra" are never reached so they go last.
+	std::string sample("the cat sat on a car");
+	t.Relayout(&sample[0], &sample[sample.size()-1]);
+	TEST(t.ValidateState());
+	root = t.GetRootNode();
+	const TrieNode<char>* z = root->FindNode('z');
+	TEST(z!=NULL);
+	TEST(z->FindNode('e') > root->FindNode('c')->FindNode('a')->FindNode('t'));
+	searchResults.clear();
+	Search( test, t, searchResults );
+	ResultIds(searchResults, after);
+	TEST(after.size()==before.size()+1);
+
+	// a relaid out trie can be cloned, moved and swapped
+	Trie<char> clone = t.Clone();
+	Trie<char> moved(std::move(t));
+	TEST(clone.ValidateState());
+	TEST(moved.ValidateState());
+	searchResults.clear();
+	Search( test, clone, searchResults );
+	std::vector<std::pair<size_t,const char*> > cloned;
+	ResultIds(searchResults, cloned);
+	TEST(cloned==after);
+	swap(clone, t);
+	TEST(t.ValidateState());
+}
+
+void TestTaggedDictionaries()
+{
+	enum { Animals, Colours, Blocked };
+	Trie<char> t;
+	std::map<const void *,std::string> dictionary;
+	std::vector<SearchResult<char> > searchResults;
+
+	dictionary[t.AddTaggedWord("fox", Animals)] = "fox";
+	dictionary[t.AddTaggedWord("dog", Animals)] = "dog";
+	dictionary[t.AddTaggedWord("brown", Colours)] = "brown";
+	dictionary[t.AddTaggedWord("dog", Blocked)] = "dog";
+	AddWord<char>("lazy", t, dictionary);
+	TEST(t.GetWordCount()==4);
+
+	std::string test("the quick brown fox jumped over the lazy dog");
+	for(size_t i = 0; i < test.size(); ++i)
+	{
+		t.SearchTagged(&test[i], &test[test.size()-1], searchResults, TagSet(1) << Animals);
+	}
+	TEST(searchResults.size()==2);
+	TEST(dictionary[searchResults[0].GetResult()]=="fox");
+	TEST(searchResults[0].GetPosition()==&test[18]);
+	TEST(dictionary[searchResults[1].GetResult()]=="dog");
+	TEST(searchResults[1].GetPosition()==&test[43]);
+	TEST(t.GetTags(searchResults[1].GetResult())==((TagSet(1) << Animals) | (TagSet(1) << Blocked)));
+
+	// several dictionaries in one pass, split up afterwards
+	searchResults.clear();
+	for(size_t i = 0; i < test.size(); ++i)
+	{
+		t.SearchTagged(&test[i], &test[test.size()-1], searchResults, (TagSet(1) << Colours) | (TagSet(1) << Blocked));
+	}
+	TEST(searchResults.size()==2);
+	TEST(dictionary[searchResults[0].GetResult()]=="brown");
+	TEST(t.GetTags(searchResults[0].GetResult())==(TagSet(1) << Colours));
+	TEST(dictionary[searchResults[1].GetResult()]=="dog");
+
+	// untagged words are found by Search() only
+	searchResults.clear();
+	Search( test, t, searchResults );
+	TEST(searchResults.size()==4);
+	TEST(t.GetTags(searchResults[2].GetResult())==0);
+
+	// tags survive Clone()
+	Trie<char> clone = t.Clone();
+	searchResults.clear();
+	clone.SearchTagged(&test[16], &test[test.size()-1], searchResults, TagSet(1) << Animals, true);
+	TEST(searchResults.size()==1);
+	TEST(clone.GetTags(searchResults[0].GetResult())==(TagSet(1) << Animals));
+	TEST(Trie<char>::MaxTags==64);
+
+	// a tag out of range is refused and the word is not added
+	const size_t wordCount = t.GetWordCount();
+	TEST(NULL==t.AddTaggedWord("zebra", Trie<char>::MaxTags));
+	TEST(NULL==t.AddTaggedWord("zebra", 1000));
+	TEST(NULL==t.Contains("zebra"));
+	TEST(t.GetWordCount()==wordCount);
+}
+
+typedef Trie<char,BitmapTrieNode> BitmapTrie;
+
+void TestBitmapTrieNode()
+{
+	BitmapTrieNode t('a');
+	TEST('a'==t.GetChar());
+	TEST(t.IsEndNode());
+	void * pZ = t.AddNode('z');
+	void * pD = t.AddNode('d');
+	void * pB = t.AddNode('b');
+	void * pF = t.AddNode('f');
+	TEST(NULL == t.AddNode('f'));
+	void * pHigh = t.AddNode('\xe9');
+	void * pNul = t.AddNode('\0');
+	void * pX = t.AddNode('x');
+	const BitmapTrieNode& ctr = t;
+
+	TEST(7==t.GetChildCount());
+	TEST(pB==t.FindNode('b'));
+	TEST(pD==t.FindNode('d'));
+	TEST(pF==t.FindNode('f'));
+	TEST(pX==t.FindNode('x'));
+	TEST(pZ==t.FindNode('z'));
+	TEST(pHigh==t.FindNode('\xe9'));
+	TEST(pNul==t.FindNode('\0'));
+	TEST(NULL==t.FindNode('c'));
+	TEST(NULL==t.FindNode('\xff'));
+	TEST(pZ==ctr.FindNode('z'));
+
+	// children are in unsigned character order
+	TEST(pNul==t.GetChild(0));
+	TEST(pB==t.GetChild(1));
+	TEST(pZ==t.GetChild(5));
+	TEST(pHigh==t.GetChild(6));
+}
+
+void TestBitmapTrie()
+{
+	BitmapTrie t;
+	std::map<const void *,std::string> dictionary;
+	std::vector<SearchResult<char> > searchResults;
+
+	AddWord<char>("at", t, dictionary);
+	AddWord<char>("bat", t, dictionary);
+	AddWord<char>("\xc3\xa9t\xc3\xa9", t, dictionary);
+	t.Compress();
+	TEST(t.ValidateState());
+
+	std::string test("bat \xc3\xa9t\xc3\xa9");
+	Search( test, t, searchResults );
+	TEST(searchResults.size()==3);
+	TEST(dictionary[searchResults[0].GetResult()]=="bat");
+	TEST(searchResults[0].GetPosition()==&test[2]);
+	TEST(dictionary[searchResults[1].GetResult()]=="at");
+	TEST(searchResults[1].GetPosition()==&test[2]);
+	TEST(dictionary[searchResults[2].GetResult()]=="\xc3\xa9t\xc3\xa9");
+	TEST(searchResults[2].GetPosition()==&test[8]);
+
+	t.Relayout();
+	BitmapTrie clone = t.Clone();
+	TEST(t.ValidateState());
+	TEST(clone.ValidateState());
+	searchResults.clear();
+	Search( test, clone, searchResults );
+	TEST(searchResults.size()==3);
+}
+
+void TestLoader()
+{
+	// the same words added one at a time, with duplicates, tags, blank
+	// lines and DOS line endings
+	const char * lines[] = { "fox", "dog\t1", "", "cat\r", "\xe9t\xe9", "fox\t0", "dogs", "ant\t63", "zebra", "d", "cattle\t2", "yak\t64", "emu\t640", "gnu\t" };
+	Trie<char> expected;
+	std::string file;
+	for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); ++i)
+	{
+		std::string word(lines[i]);
+		file.append(word);
+		file.append("\n");
+		size_t tab = word.find('\t');
+		size_t cr = word.find('\r');
+		if (tab + 1 == word.size())
+		{
+			expected.AddWord(word.substr(0, tab));
+		}
+		else if (tab != std::string::npos)
+		{
+			expected.AddTaggedWord(word.substr(0, tab), atoi(&word[tab+1]));
+		}
+		else if (!word.empty())
+		{
+			expected.AddWord(word.substr(0, cr));
+		}
+	}
+	file.append("no newline at the end");
+	expected.AddWord("no newline at the end");
+
+	const char * path = "trie_loader_test.txt";
+	std::ofstream(path) << file;
+
+	for (unsigned int threads = 1; threads <= 4; ++threads)
+	{
+		Trie<char> t;
+		TEST(TrieLoader<>::Load(path, t, threads));
+		TEST(t.ValidateState());
+		TEST(NULL==t.Contains("yak"));
+		TEST(NULL==t.Contains("emu"));
+		TEST(t.GetWordCount()==expected.GetWordCount());
+
+		std::vector<SearchResult<char> > searchResults;
+		std::vector<SearchResult<char> > expectedResults;
+		std::vector<std::pair<size_t,const char*> > ids;
+		std::vector<std::pair<size_t,const char*> > expectedIds;
+		Search( file, t, searchResults );
+		Search( file, expected, expectedResults );
+		ResultIds(searchResults, ids);
+		ResultIds(expectedResults, expectedIds);
+		TEST(ids==expectedIds);
+		for (size_t i = 0; i < searchResults.size(); ++i)
+		{
+			if (t.GetTags(searchResults[i].GetResult())!=expected.GetTags(expectedResults[i].GetResult()))
+			{
+				TEST(false);
+			}
+		}
+	}
+
+	BitmapTrie bt;
+	TEST(TrieLoader<BitmapTrieNode>::Load(path, bt));
+	TEST(bt.ValidateState());
+	TEST(bt.GetWordCount()==expected.GetWordCount());
+	remove(path);
+
+	// a pipe has no size and is read rather than mapped
+	TEST(0==mkfifo(path, 0600));
+	std::thread writer([&]() { std::ofstream(path) << file; });
+	Trie<char> piped;
+	TEST(TrieLoader<>::Load(path, piped));
+	writer.join();
+	TEST(piped.ValidateState());
+	TEST(piped.GetWordCount()==expected.GetWordCount());
+	TEST(NULL!=piped.Contains("gnu"));
+	remove(path);
+
+	Trie<char> t;
+	TEST(!TrieLoader<>::Load(path, t));
+}
+
+// scans input with a TrieScanner in steps of the given size and checks
+// the results are the same as a full search
+void CheckScanner( const std::string& input, const Trie<char>& t, size_t maxCharacters, size_t maxMatches, bool stopAtFirstMatch )
+{
+	std::vector<SearchResult<char> > searchResults;
+	std::vector<SearchResult<char> > scanResults;
+	Search( input, t, searchResults, stopAtFirstMatch );
+
+	TrieScanner<char> scanner(t, &input[0], &input[input.size()-1], stopAtFirstMatch);
+	size_t steps = 0;
+	while (scanner.Step(scanResults, maxCharacters, maxMatches))
+	{
+		++steps;
+		if (scanner.IsDone())
+		{
+			TEST(false);
+		}
+	}
+	TEST(scanner.IsDone());
+	TEST(!scanner.Step(scanResults, maxCharacters, maxMatches));
+	TEST(searchResults.size()==scanResults.size());
+	for (size_t i = 0; i < searchResults.size(); ++i)
+	{
+		if (searchResults[i].GetResult()!=scanResults[i].GetResult() ||
+			searchResults[i].GetPosition()!=scanResults[i].GetPosition())
+		{
+			TEST(false);
+		}
+	}
+	if (maxMatches < searchResults.size())
+	{
+		TEST(steps >= searchResults.size() / maxMatches);
+	}
+}
+
+void TestScanner()
+{
+	Trie<char> t;
+	t.AddWord("a");
+	t.AddWord("ab");
+	t.AddWord("abc");
+	t.AddWord("abcdefg");
+	t.AddWord("bcd");
+	t.AddWord("g");
+
+	std::string test("abc abcdefg a a a abcdef abcd abcd g");
+	CheckScanner( test, t, 1, static_cast<size_t>(-1), false );
+	CheckScanner( test, t, 3, static_cast<size_t>(-1), false );
+	CheckScanner( test, t, 1000, 1, false );
+	CheckScanner( test, t, 7, 2, false );
+	CheckScanner( test, t, 5, 1, true );
+	CheckScanner( test, t, 1000000, static_cast<size_t>(-1), false );
+
+	// a slice never looks at more than the characters asked for
+	std::vector<SearchResult<char> > scanResults;
+	TrieScanner<char> scanner(t, &test[0], &test[test.size()-1]);
+	TEST(scanner.Step(scanResults, 4));
+	// "a", "ab", "abc" then the space fails
+	TEST(scanResults.size()==3);
+	TEST(scanner.GetPosition()==&test[1]);
+	// a step that can scan nothing says so rather than claiming progress
+	TEST(!scanner.Step(scanResults, 0));
+	TEST(!scanner.Step(scanResults, 1, 0));
+	TEST(!scanner.IsDone());
+	TEST(scanResults.size()==3);
+	TEST(scanner.GetPosition()==&test[1]);
+}
+
+template <typename NodeType>
+void CheckBatchLookups()
+{
+	Trie<char,NodeType> t;
+	std::vector<std::string> words;
+	words.push_back("com");
+	words.push_back("com.example");
+	words.push_back("com.example.www");
+	words.push_back("org");
+	words.push_back("org.example");
+	for (size_t i = 0; i < words.size(); ++i)
+	{
+		t.AddWord(words[i]);
+	}
+
+	// more queries than one batch of 16
+	std::vector<std::string> queries;
+	for (size_t i = 0; i < 3; ++i)
+	{
+		queries.push_back("com");
+		queries.push_back("co");
+		queries.push_back("com.example");
+		queries.push_back("com.example.mail");
+		queries.push_back("com.example.www");
+		queries.push_back("com.example.www.images");
+		queries.push_back("org.exam");
+		queries.push_back("net");
+		queries.push_back("");
+	}
+	std::vector<const char*> starts;
+	std::vector<const char*> ends;
+	for (size_t i = 0; i < queries.size(); ++i)
+	{
+		starts.push_back(queries[i].c_str());
+		ends.push_back(queries[i].c_str() + queries[i].size() - 1);
+	}
+
+	std::vector<const void*> results(queries.size());
+	std::vector<const char*> positions(queries.size());
+	t.ContainsBatch(&starts[0], &ends[0], queries.size(), &results[0]);
+	for (size_t i = 0; i < queries.size(); i += 9)
+	{
+		TEST(results[i]==t.AddWord("com"));
+		TEST(results[i+1]==NULL);
+		TEST(results[i+2]==t.AddWord("com.example"));
+		TEST(results[i+3]==NULL);
+		TEST(results[i+4]==t.AddWord("com.example.www"));
+		TEST(results[i+5]==NULL);
+		TEST(results[i+6]==NULL);
+		TEST(results[i+7]==NULL);
+		TEST(results[i+8]==NULL);
+	}
+
+	t.LongestPrefixBatch(&starts[0], &ends[0], queries.size(), &results[0], &positions[0]);
+	for (size_t i = 0; i < queries.size(); i += 9)
+	{
+		TEST(results[i]==t.AddWord("com"));
+		TEST(positions[i]==starts[i]+2);
+		TEST(results[i+1]==NULL);
+		TEST(positions[i+1]==NULL);
+		TEST(results[i+2]==t.AddWord("com.example"));
+		TEST(results[i+3]==t.AddWord("com.example"));
+		TEST(positions[i+3]==starts[i+3]+10);
+		TEST(results[i+4]==t.AddWord("com.example.www"));
+		TEST(results[i+5]==t.AddWord("com.example.www"));
+		TEST(positions[i+5]==starts[i+5]+14);
+		TEST(results[i+6]==t.AddWord("org"));
+		TEST(results[i+7]==NULL);
+		TEST(results[i+8]==NULL);
+	}
+	TEST(t.GetWordCount()==words.size());
+}
+
+void TestBatchLookups()
+{
+	CheckBatchLookups<TrieNode<char> >();
+	CheckBatchLookups<BitmapTrieNode>();
+}
+
+template <typename NodeType>
+void CheckContainsAndLongestPrefix()
+{
+	Trie<char,NodeType> t;
+	const void * com = t.AddWord("com");
+	const void * example = t.AddWord("com.example");
+	const void * www = t.AddWord("com.example.www");
+
+	TEST(t.Contains("com")==com);
+	TEST(t.Contains(std::string("com.example"))==example);
+	TEST(t.Contains("com.example.www")==www);
+	TEST(t.Contains("com.")==NULL);
+	TEST(t.Contains("co")==NULL);
+	TEST(t.Contains("com.example.www.images")==NULL);
+	TEST(t.Contains("")==NULL);
+
+	std::string url("com.example.mail");
+	const char * position = NULL;
+	TEST(t.LongestPrefix(url, &position)==example);
+	TEST(position==&url[10]);
+	url = "com.example.www";
+	TEST(t.LongestPrefix(url, &position)==www);
+	TEST(position==&url[14]);
+	TEST(t.LongestPrefix("comet")==com);
+	url = "co";
+	TEST(t.LongestPrefix(url, &position)==NULL);
+	TEST(position==NULL);
+	TEST(t.LongestPrefix("")==NULL);
+	// position is cleared, not left from the last call
+	const std::string comet("comet");
+	TEST(t.LongestPrefix(comet, &position)==com);
+	TEST(position==&comet[2]);
+	TEST(t.LongestPrefix(std::string(), &position)==NULL);
+	TEST(position==NULL);
+	TEST(t.LongestPrefix("org")==NULL);
+}
+
+void TestContainsAndLongestPrefix()
+{
+	CheckContainsAndLongestPrefix<TrieNode<char> >();
+	CheckContainsAndLongestPrefix<BitmapTrieNode>();
+}
+
+void TestBoundedSearch()
+{
+	// the adversarial case: every prefix of the input is a word
+	Trie<char> t;
+	std::vector<const void*> words;
+	std::string word;
+	for (size_t i = 0; i < 100; ++i)
+	{
+		word.append(1, 'a');
+		words.push_back(t.AddWord(word));
+	}
+	const std::string input(1000, 'a');
+	const char* end = &input[input.size()-1];
+
+	SearchResult<char> storage[8];
+	BoundedSearchResults<char> results(storage, 8);
+	TEST(results.GetCapacity()==8);
+	// the ninth match does not fit
+	TEST(t.Search(&input[0], end, results)==8);
+	TEST(results.GetSize()==8);
+	TEST(results.IsFull());
+	TEST(results.IsTruncated());
+	TEST(results.GetDropped()==1);
+	for (size_t i = 0; i < results.GetSize(); ++i)
+	{
+		TEST(results[i].GetResult()==words[i]);
+		TEST(results[i].GetPosition()==&input[i]);
+	}
+
+	// keep the newest results instead
+	BoundedSearchResults<char> newest(storage, 8, BoundedSearchResults<char>::OverwriteOldest);
+	TEST(t.Search(&input[0], end, newest)==100);
+	TEST(newest.GetSize()==8);
+	TEST(!newest.IsFull());
+	TEST(newest.IsTruncated());
+	TEST(newest.GetDropped()==92);
+	for (size_t i = 0; i < newest.GetSize(); ++i)
+	{
+		TEST(newest[i].GetResult()==words[92+i]);
+	}
+	newest.PopFront();
+	TEST(newest.GetSize()==7);
+	TEST(newest[0].GetResult()==words[93]);
+	for (size_t i = 0; i < 7; ++i)
+	{
+		newest.PopFront();
+	}
+	TEST(newest.GetSize()==0);
+	newest.PopFront();
+	TEST(newest.GetSize()==0);
+
+	// a ring with no room is always full and never divides by its capacity
+	BoundedSearchResults<char> none(storage, 0);
+	TEST(none.IsFull());
+	TEST(t.Search(&input[0], end, none)==0);
+	TEST(none.GetSize()==0);
+	TEST(none.IsTruncated());
+	TEST(none.GetDropped()==1);
+	none.PopFront();
+	TEST(none.GetSize()==0);
+	BoundedSearchResults<char> noneNewest(storage, 0, BoundedSearchResults<char>::OverwriteOldest);
+	TEST(t.Search(&input[0], end, noneNewest)==0);
+	TEST(noneNewest.GetDropped()==1);
+	TrieScanner<char> noRoom(t, &input[0], end);
+	TEST(!noRoom.Step(none, static_cast<size_t>(-1)));
+	TEST(!noRoom.IsDone());
+
+	// match and character caps
+	results.Clear();
+	TEST(!results.IsTruncated());
+	TEST(t.Search(&input[0], end, results, false, 3)==3);
+	TEST(results.GetSize()==3);
+	TEST(results.IsTruncated());
+	results.Clear();
+	TEST(t.Search(&input[0], end, results, false, 8, 5)==5);
+	TEST(results.IsTruncated());
+	results.Clear();
+	TEST(t.Search(&input[0], &input[4], results, false, 5, 5)==5);
+	TEST(!results.IsTruncated());
+	results.Clear();
+	TEST(t.Search(&input[0], end, results, true)==1);
+	TEST(!results.IsTruncated());
+	TEST(results[0].GetResult()==words[0]);
+
+	// the same results as the vector search when nothing is lost
+	Trie<char> fox;
+	fox.AddWord("fox");
+	fox.AddWord("fo");
+	fox.AddWord("o");
+	const std::string text("the quick brown fox");
+	results.Clear();
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		fox.Search(&text[i], &text[text.size()-1], results);
+	}
+	std::vector<SearchResult<char> > searchResults;
+	Search(text, fox, searchResults);
+	TEST(!results.IsTruncated());
+	TEST(results.GetSize()==searchResults.size());
+	for (size_t i = 0; i < results.GetSize(); ++i)
+	{
+		TEST(results[i].GetResult()==searchResults[i].GetResult());
+		TEST(results[i].GetPosition()==searchResults[i].GetPosition());
+	}
+
+	// streaming a whole buffer through the ring with a TrieScanner
+	std::vector<SearchResult<char> > expected;
+	Search(input, t, expected);
+	std::vector<SearchResult<char> > streamed;
+	results.Clear();
+	TrieScanner<char> scanner(t, &input[0], end);
+	bool more = true;
+	while (more)
+	{
+		more = scanner.Step(results, static_cast<size_t>(-1));
+		TEST(results.GetSize()<=results.GetCapacity());
+		for (; results.GetSize(); results.PopFront())
+		{
+			streamed.push_back(results[0]);
+		}
+	}
+	TEST(!results.IsTruncated());
+	TEST(streamed.size()==expected.size());
+
+	// a full ring that is not drained stops the scanner at the next match
+	results.Clear();
+	TrieScanner<char> stalled(t, &input[0], end);
+	TEST(stalled.Step(results, static_cast<size_t>(-1)));
+	TEST(results.IsFull());
+	const char* position = stalled.GetPosition();
+	TEST(!stalled.Step(results, static_cast<size_t>(-1)));
+	TEST(!stalled.IsDone());
+	TEST(stalled.GetPosition()==position);
+	TEST(!results.IsTruncated());
+	results.PopFront();
+	TEST(stalled.Step(results, static_cast<size_t>(-1)));
+	TEST(results[7].GetResult()==expected[8].GetResult());
+	TEST(results[7].GetPosition()==expected[8].GetPosition());
+	for (size_t i = 0; i < expected.size(); ++i)
+	{
+		if (streamed[i].GetResult()!=expected[i].GetResult() ||
+			streamed[i].GetPosition()!=expected[i].GetPosition())
+		{
+			TEST(false);
+		}
+	}
+
+	// a scanner into an overwriting ring keeps the last results
+	newest.Clear();
+	TrieScanner<char> last(t, &input[0], end);
+	TEST(!last.Step(newest, static_cast<size_t>(-1)));
+	TEST(newest.IsTruncated());
+	TEST(newest.GetSize()==8);
+	TEST(newest.GetDropped()==expected.size()-8);
+	TEST(newest[7].GetPosition()==end);
+}
+
+typedef SortedArrayTrieNode<char> SortedArrayNode;
+typedef DenseTrieNode<char> DenseNode;
+
+void TestIsTrieNode()
+{
+	const bool trieNode = IsTrieNode<TrieNode<char>,char>::value;
+	const bool wideTrieNode = IsTrieNode<TrieNode<wchar_t>,wchar_t>::value;
+	const bool bitmapNode = IsTrieNode<BitmapTrieNode,char>::value;
+	const bool sortedArrayNode = IsTrieNode<SortedArrayNode,char>::value;
+	const bool denseNode = IsTrieNode<DenseNode,char>::value;
+	TEST(trieNode);
+	TEST(wideTrieNode);
+	TEST(bitmapNode);
+	TEST(sortedArrayNode);
+	TEST(denseNode);
+
+	// StaticTrieNode can be searched but not built
+	const bool staticLookup = IsTrieNode<StaticTrieNode<char>,char>::HasLookup;
+	const bool staticBuild = IsTrieNode<StaticTrieNode<char>,char>::HasBuild;
+	const bool staticNode = IsTrieNode<StaticTrieNode<char>,char>::value;
+	const bool intNode = IsTrieNode<int,char>::value;
+	TEST(!staticLookup);
+	TEST(!staticBuild);
+	TEST(!staticNode);
+	TEST(!intNode);
+}
+
+void TestSortedArrayTrieNode()
+{
+	SortedArrayNode t('a');
+	TEST('a'==t.GetChar());
+	TEST(t.IsEndNode());
+	// more children than are scanned, so they are binary searched
+	std::vector<SortedArrayNode*> nodes(256, static_cast<SortedArrayNode*>(NULL));
+	const char * order = "zdbf\x01xQ0a9ymcoek&~-qlwgpjrnsuhitv";
+	for (const char* c = order; *c; ++c)
+	{
+		nodes[static_cast<unsigned char>(*c)] = t.AddNode(*c);
+		TEST(NULL != nodes[static_cast<unsigned char>(*c)]);
+	}
+	TEST(NULL == t.AddNode('f'));
+	TEST(strlen(order)==t.GetChildCount());
+	for (size_t i = 0; i < 256; ++i)
+	{
+		if (nodes[i]!=t.FindNode(static_cast<char>(i)))
+		{
+			TEST(false);
+		}
+	}
+	// children are in alphabetical order
+	for (size_t i = 1; i < t.GetChildCount(); ++i)
+	{
+		TEST(t.GetChild(i-1)->GetChar() < t.GetChild(i)->GetChar());
+	}
+	t.Compress();
+	TEST(nodes['k']==t.FindNode('k'));
+	TEST(NULL==t.FindNode('Z'));
+	const SortedArrayNode& ctr = t;
+	TEST(nodes['z']==ctr.FindNode('z'));
+}
+
+void TestDenseTrieNode()
+{
+	DenseNode t('a');
+	TEST('a'==t.GetChar());
+	TEST(t.IsEndNode());
+	void * pM = t.AddNode('m');
+	TEST(pM==t.FindNode('m'));
+	TEST(NULL==t.FindNode('l'));
+	TEST(NULL==t.FindNode('n'));
+	// the table widens both ways
+	void * pD = t.AddNode('d');
+	void * pX = t.AddNode('x');
+	TEST(NULL == t.AddNode('x'));
+	void * pHigh = t.AddNode('\xe9');
+	void * pNul = t.AddNode('\0');
+	TEST(5==t.GetChildCount());
+	TEST(pM==t.FindNode('m'));
+	TEST(pD==t.FindNode('d'));
+	TEST(pX==t.FindNode('x'));
+	TEST(pHigh==t.FindNode('\xe9'));
+	TEST(pNul==t.FindNode('\0'));
+	TEST(NULL==t.FindNode('e'));
+	TEST(NULL==t.FindNode('\xff'));
+
+	// children are in unsigned character order
+	TEST(pNul==t.GetChild(0));
+	TEST(pD==t.GetChild(1));
+	TEST(pX==t.GetChild(3));
+	TEST(pHigh==t.GetChild(4));
+
+	// the widest table, every byte value
+	DenseTrieNode<unsigned char> u('a');
+	void * pFF = u.AddNode(0xff);
+	void * p00 = u.AddNode(0);
+	TEST(pFF==u.FindNode(0xff));
+	TEST(p00==u.FindNode(0));
+	TEST(NULL==u.FindNode(0x80));
+	TEST(p00==u.GetChild(0));
+	TEST(pFF==u.GetChild(1));
+}
+
+// builds the same dictionary into a Trie<char> and a Trie<char,Node> and
+// checks they find the same matches
+template<typename Node>
+void CheckMatchesTrie()
+{
+	Trie<char> t;
+	Trie<char,Node> other;
+	std::vector<SearchResult<char> > searchResults;
+	std::vector<SearchResult<char> > otherResults;
+
+	std::default_random_engine generator;
+	std::uniform_int_distribution<int> dRandByte(0,255);
+	std::uniform_int_distribution<size_t> dRandSize(1,4);
+	std::string test;
+	for (size_t i = 0; i < 20000; ++i)
+	{
+		test.append(1, static_cast<char>(dRandByte(generator) % 8 ? 'a' + dRandByte(generator) % 4 : dRandByte(generator)));
+	}
+	for (size_t w = 0; w < 500; ++w)
+	{
+		const size_t start = dRandByte(generator) * 64;
+		const std::string word = test.substr(start, dRandSize(generator));
+		TEST(Trie<char>::GetWordId(t.AddWord(word))==(Trie<char,Node>::GetWordId(other.AddWord(word))));
+	}
+	other.Compress();
+	TEST(other.ValidateState());
+
+	Search( test, t, searchResults );
+	Search( test, other, otherResults );
+	TEST(searchResults.size()==otherResults.size());
+	for (size_t i = 0; i < searchResults.size(); ++i)
+	{
+		if (Trie<char>::GetWordId(searchResults[i].GetResult())!=Trie<char,Node>::GetWordId(otherResults[i].GetResult()) ||
+			searchResults[i].GetPosition()!=otherResults[i].GetPosition())
+		{
+			TEST(false);
+		}
+	}
+
+	other.Relayout();
+	TEST(other.ValidateState());
+	// adding to a packed child list moves it to one of the node's own
+	for (size_t w = 0; w < 100; ++w)
+	{
+		const size_t start = dRandByte(generator) * 64 + 8;
+		const std::string word = test.substr(start, dRandSize(generator));
+		TEST(Trie<char>::GetWordId(t.AddWord(word))==(Trie<char,Node>::GetWordId(other.AddWord(word))));
+	}
+	searchResults.clear();
+	Search( test, t, searchResults );
+	Trie<char,Node> clone = other.Clone();
+	TEST(other.ValidateState());
+	TEST(clone.ValidateState());
+	otherResults.clear();
+	Search( test, clone, otherResults );
+	TEST(searchResults.size()==otherResults.size());
+}
+
+void TestNodeLayouts()
+{
+	CheckMatchesTrie<BitmapTrieNode>();
+	CheckMatchesTrie<SortedArrayNode>();
+	CheckMatchesTrie<DenseNode>();
+	CheckBatchLookups<SortedArrayNode>();
+	CheckBatchLookups<DenseNode>();
+	CheckContainsAndLongestPrefix<SortedArrayNode>();
+	CheckContainsAndLongestPrefix<DenseNode>();
+
+	Trie<wchar_t,SortedArrayTrieNode<wchar_t> > t;
+	std::map<const void *,std::wstring> dictionary;
+	std::vector<SearchResult<wchar_t> > searchResults;
+	AddWord<wchar_t>(L"\x3b1\x3b2", t, dictionary);
+	AddWord<wchar_t>(L"\x3b2", t, dictionary);
+	std::wstring test(L"a\x3b1\x3b2");
+	Search( test, t, searchResults );
+	TEST(searchResults.size()==2);
+	TEST(dictionary[searchResults[0].GetResult()]==L"\x3b1\x3b2");
+	TEST(dictionary[searchResults[1].GetResult()]==L"\x3b2");
+}
+
+void TestTrieNodeSize()
+{
+	// the end of word flag shares the word id so there is no padding
+	TEST(sizeof(TrieNode<char>)==sizeof(void*) + sizeof(unsigned int) + sizeof(unsigned int));
+	TEST(sizeof(TrieNode<wchar_t>)<=sizeof(void*) + sizeof(unsigned int) + sizeof(wchar_t));
+
+	TrieNode<char> t('a');
+	TEST(!t.IsEndOfWord());
+	t.SetWordId(0x7fffffff);
+	TEST(!t.IsEndOfWord());
+	TEST(0x7fffffff==t.GetWordId());
+	t.SetEndOfWord();
+	TEST(t.IsEndOfWord());
+	TEST(0x7fffffff==t.GetWordId());
+	t.SetWordId(5);
+	TEST(t.IsEndOfWord());
+	TEST(5==t.GetWordId());
+
+	// AddWord() and TrieLoader stop before an id would reach the flag
+	TEST(Trie<char>::MaxWords==(size_t(1) << 31));
+}
+
+void TestCompactTrie()
+{
+	CompactTrie<char> empty;
+	std::vector<SearchResult<char> > searchResults;
+	const std::string a("a");
+	empty.Search(&a[0], &a[0], searchResults);
+	TEST(searchResults.empty());
+	TEST(empty.GetNodeCount()==1);
+	TEST(empty.GetWordCount()==0);
+	TEST(NULL==empty.Contains(&a[0], &a[0]));
+
+	Trie<char> t;
+	const void * fox = t.AddWord("fox");
+	const void * fo = t.AddWord("fo");
+	const void * dog = t.AddWord("dog");
+	t.AddWord("\xe9t\xe9");
+	const CompactTrie<char> ct(t);
+	TEST(ct.GetWordCount()==4);
+	TEST(ct.GetNodeCount()==10);
+	TEST(ct.GetMemoryUsage()==11 * sizeof(unsigned int) + 10 * sizeof(unsigned int) + 9);
+
+	std::string test("the fox and the dog \xe9t\xe9");
+	std::vector<SearchResult<char> > expected;
+	Search( test, t, expected );
+	Search( test, ct, searchResults );
+	TEST(searchResults.size()==4);
+	TEST(searchResults.size()==expected.size());
+	for (size_t i = 0; i < searchResults.size(); ++i)
+	{
+		TEST(CompactTrie<char>::GetWordId(searchResults[i].GetResult())==Trie<char>::GetWordId(expected[i].GetResult()));
+		TEST(searchResults[i].GetPosition()==expected[i].GetPosition());
+	}
+
+	const std::string foxes("foxes");
+	const char * position = NULL;
+	TEST(CompactTrie<char>::GetWordId(ct.LongestPrefix(&foxes[0], &foxes[4], &position))==Trie<char>::GetWordId(fox));
+	TEST(position==&foxes[2]);
+	TEST(CompactTrie<char>::GetWordId(ct.Contains(&foxes[0], &foxes[1]))==Trie<char>::GetWordId(fo));
+	TEST(CompactTrie<char>::GetWordId(ct.Contains(&test[16], &test[18]))==Trie<char>::GetWordId(dog));
+	TEST(NULL==ct.Contains(&foxes[0], &foxes[0]));
+	TEST(NULL==ct.Contains(&foxes[0], &foxes[4]));
+	TEST(NULL==ct.LongestPrefix(&test[0], &test[2], &position));
+	TEST(NULL==position);
+
+	// a bigger dictionary, from a different node type, with nodes wide
+	// enough to be binary searched
+	BitmapTrie bt;
+	std::default_random_engine generator;
+	std::uniform_int_distribution<int> dRandByte(0,255);
+	std::uniform_int_distribution<size_t> dRandSize(1,6);
+	std::string text;
+	for (size_t i = 0; i < 20000; ++i)
+	{
+		text.append(1, static_cast<char>(dRandByte(generator)));
+	}
+	for (size_t w = 0; w < 2000; ++w)
+	{
+		bt.AddWord(text.substr(dRandByte(generator) * 64 + dRandByte(generator), dRandSize(generator)));
+	}
+	const CompactTrie<char> big(bt);
+	expected.clear();
+	searchResults.clear();
+	Search( text, bt, expected );
+	Search( text, big, searchResults );
+	TEST(searchResults.size()==expected.size());
+	for (size_t i = 0; i < searchResults.size(); ++i)
+	{
+		if (CompactTrie<char>::GetWordId(searchResults[i].GetResult())!=BitmapTrie::GetWordId(expected[i].GetResult()) ||
+			searchResults[i].GetPosition()!=expected[i].GetPosition())
+		{
+			TEST(false);
+		}
+	}
+
+	Trie<wchar_t> wt;
+	wt.AddWord(L"\x3b1\x3b2");
+	const CompactTrie<wchar_t> wct(wt);
+	std::wstring wide(L"a\x3b1\x3b2");
+	std::vector<SearchResult<wchar_t> > wideResults;
+	Search( wide, wct, wideResults );
+	TEST(wideResults.size()==1);
+	TEST(wideResults[0].GetPosition()==&wide[2]);
+}
+
 int main(int argc, char* argv[])
 {
 	TestOverlapDictionaryShortestFirst2();
@@ -680,6 +1937,29 @@ int main(int argc, char* argv[])
 	TestRandomWords(300, 3, 5);
 	TestRandomWords(1000, 3, 10);
 	TestRandomWords(10000, 4, 12);
+	TestStaticTrieGenerated();
+	TestStaticTrieMatchesTrie();
+	TestMoveAndSwap();
+	TestClone();
+	TestTrieHandle();
+	TestWordIds();
+	TestCount();
+	TestStats();
+	TestRelayout();
+	TestTaggedDictionaries();
+	TestBitmapTrieNode();
+	TestBitmapTrie();
+	TestLoader();
+	TestScanner();
+	TestBatchLookups();
+	TestContainsAndLongestPrefix();
+	TestBoundedSearch();
+	TestIsTrieNode();
+	TestSortedArrayTrieNode();
+	TestDenseTrieNode();
+	TestNodeLayouts();
+	TestTrieNodeSize();
+	TestCompactTrie();
 
 	// sample code: simple example of how to use the Trie.
 	Trie<char> t;
@@ -0,0 +1,97 @@
+// This source was written by Stephen Oswin, and is placed in the
+// public domain. The author hereby disclaims copyright to this source
+// code.
+
+// trie_gen reads a newline delimited keyword file and writes a header
+// containing constexpr StaticTrie tables for it. Usage:
+//   trie_gen <keyword file> <name> <output header>
+// The header defines <name>_nodes (the node table), <name>_words (the
+// node index of each keyword, in file order) and <name> (the StaticTrie).
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "StaticTrie.h"
+
+using namespace TDS;
+
+void WriteChar( std::ostream& os, char c )
+{
+	char hex[8];
+	snprintf(hex, sizeof(hex), "'\\x%02x'", static_cast<unsigned char>(c));
+	os << hex;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc != 4)
+	{
+		std::cerr << "usage: trie_gen <keyword file> <name> <output header>" << std::endl;
+		return 1;
+	}
+	std::ifstream in(argv[1]);
+	if (!in)
+	{
+		std::cerr << "trie_gen: cannot open " << argv[1] << std::endl;
+		return 1;
+	}
+	const std::string name(argv[2]);
+
+	Trie<char> t;
+	std::vector<const void*> words;
+	std::string line;
+	while (std::getline(in, line))
+	{
+		if (!line.empty() && line[line.size()-1] == '\r')
+		{
+			line.erase(line.size()-1);
+		}
+		if (!line.empty())
+		{
+			words.push_back(t.AddWord(line));
+		}
+	}
+
+	std::vector<StaticTrieNode<char> > nodes;
+	std::map<const void*,unsigned int> handles;
+	FlattenTrie(t, nodes, &handles);
+
+	std::ofstream out(argv[3]);
+	if (!out)
+	{
+		std::cerr << "trie_gen: cannot write " << argv[3] << std::endl;
+		return 1;
+	}
+	out << "// Generated by trie_gen from " << argv[1] << ". Do not edit.\n\n";
+	out << "#ifndef __" << name << "_H\n#define __" << name << "_H\n\n";
+	out << "#include \"StaticTrie.h\"\n\n";
+
+	out << "static constexpr TDS::StaticTrieNode<char> " << name << "_nodes[] =\n{\n";
+	for (size_t i = 0; i < nodes.size(); ++i)
+	{
+		out << "\t{ ";
+		WriteChar(out, nodes[i]._c);
+		out << ", " << (nodes[i]._endOfWord ? "true" : "false")
+			<< ", " << nodes[i]._firstChild
+			<< ", " << nodes[i]._childCount << " },\n";
+	}
+	out << "};\n\n";
+
+	out << "static constexpr unsigned int " << name << "_words[] =\n{\n";
+	for (size_t i = 0; i < words.size(); ++i)
+	{
+		out << "\t" << handles[words[i]] << ",\n";
+	}
+	if (words.empty())
+	{
+		out << "\t0\n";
+	}
+	out << "};\n\n";
+
+	out << "static constexpr TDS::StaticTrie<char> " << name << "(" << name << "_nodes, "
+		<< nodes.size() << ");\n\n";
+	out << "#endif\n";
+
+	return 0;
+}